@@ -0,0 +1,106 @@
+#ifndef BATCH_H
+#define BATCH_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include "camera.h"
+#include "framebuffer.h"
+#include "hittable.h"
+#include "parallel.h"
+#include "tiles.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+
+inline std::vector<camera> turntable(const camera& base, int frames) {
+    // frames copies of base whose lookfrom orbits lookat about the vup axis, one full turn.
+    std::vector<camera> cameras;
+    vec3 k = unit_vector(base.vup);
+    vec3 v = base.lookfrom - base.lookat;
+    for (int f = 0; f < frames; f++) {
+        double angle = 2*pi * f / frames;
+        double c = std::cos(angle), s = std::sin(angle);
+        camera cam = base;
+        cam.lookfrom = base.lookat + c * v + s * cross(k, v) + (1 - c) * dot(k, v) * k;
+        cameras.push_back(cam);
+    }
+    return cameras;
+}
+
+
+// Renders many views of one resident scene on a shared thread pool. All tiles of all frames
+// go into a single parallel_for, so no core waits at the end of a frame; within each window
+// of frames_in_flight consecutive frames the tiles are dispatched round robin, one tile of
+// each frame in turn. Each tile reseeds from (seed, frame, tile), so the result does not
+// depend on the thread count or the window.
+class batch_renderer {
+  public:
+    int           tile_size        = 32;  // Tile edge in pixels
+    int           frames_in_flight = 4;   // Frames whose tiles are interleaved
+    std::uint32_t seed             = 1;
+
+    // Called once per frame, from the thread that finished its last tile.
+    std::function<void(int frame, const framebuffer& fb)> on_frame;
+
+    explicit batch_renderer(thread_pool& pool) : pool(pool) {}
+
+    std::vector<framebuffer> render(std::vector<camera>& cameras, const hittable& world) {
+        int frames = int(cameras.size());
+        std::vector<framebuffer> fbs(frames);
+        std::vector<std::vector<tile>> tiles(frames);
+        std::vector<std::atomic<int>> remaining(frames);
+
+        for (int f = 0; f < frames; f++) {
+            cameras[f].initialize();
+            fbs[f].resize(cameras[f].image_width, cameras[f].height());
+            tiles[f] = make_tiles(cameras[f].image_width, cameras[f].height(), tile_size);
+            remaining[f] = int(tiles[f].size());
+        }
+
+        struct job { int frame, tile; };
+        std::vector<job> jobs;
+        int window = std::max(1, frames_in_flight);
+        for (int first = 0; first < frames; first += window) {
+            int last = std::min(first + window, frames);
+            size_t most = 0;
+            for (int f = first; f < last; f++)
+                most = std::max(most, tiles[f].size());
+            for (size_t t = 0; t < most; t++)
+                for (int f = first; f < last; f++)
+                    if (t < tiles[f].size())
+                        jobs.push_back({f, int(t)});
+        }
+
+        pool.parallel_for(int(jobs.size()), [&](int n) {
+            auto [f, t] = jobs[n];
+            const auto& tl = tiles[f][t];
+            seed_random({seed, std::uint32_t(f), std::uint32_t(t)});
+            for (int j = tl.y0; j < tl.y1; j++)
+                for (int i = tl.x0; i < tl.x1; i++)
+                    for (int s = 0; s < cameras[f].samples_per_pixel; s++)
+                        cameras[f].add_sample(i, j, world, fbs[f]);
+
+            if (--remaining[f] == 0 && on_frame)
+                on_frame(f, fbs[f]);
+        });
+
+        return fbs;
+    }
+
+  private:
+    thread_pool& pool;
+};
+
+
+#endif
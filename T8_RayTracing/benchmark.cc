@@ -0,0 +1,181 @@
+
+#include "rtweekend.h"
+
+#include "camera.h"
+#include "hittable.h"
+#include "hittable_list.h"
+#include "progressive.h"
+#include "scenes.h"
+#include "tiles.h"
+#include "wavefront.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+// Envoltorio que cuenta los rayos que el integrador recursivo lanza contra la escena:
+// camera::ray_color llama a world.hit exactamente una vez por rayo.
+class counting_hittable : public hittable {
+  public:
+    counting_hittable(const hittable& world) : world(world) {}
+
+    bool hit(const ray& r, interval ray_t, hit_record& rec) const override {
+        count.fetch_add(1, std::memory_order_relaxed);
+        return world.hit(r, ray_t, rec);
+    }
+
+    mutable std::atomic<long long> count{0};
+
+  private:
+    const hittable& world;
+};
+
+
+// Fallos de cach del proceso (incluidos los hilos creados mientras est activo), ledos con
+// perf_event_open. Donde no hay contadores disponibles read() devuelve -1.
+class cache_miss_counter {
+  public:
+#ifdef __linux__
+    cache_miss_counter() {
+        perf_event_attr attr{};
+        attr.type           = PERF_TYPE_HARDWARE;
+        attr.size           = sizeof(attr);
+        attr.config         = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled       = 1;
+        attr.inherit        = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        fd = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    ~cache_miss_counter() { if (fd >= 0) close(fd); }
+
+    void start() {
+        if (fd < 0) return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    long long stop() {
+        if (fd < 0) return -1;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        long long misses = 0;
+        return ::read(fd, &misses, sizeof(misses)) == sizeof(misses) ? misses : -1;
+    }
+
+  private:
+    int fd = -1;
+#else
+    void start() {}
+    long long stop() { return -1; }
+#endif
+};
+
+
+// Ejecuta una funcin de render mandando la imagen de std::cout a un archivo
+template <typename Render>
+double timed_render(const std::string& filename, Render render) {
+    std::ofstream out(filename);
+    auto old_buf = std::cout.rdbuf(out.rdbuf());
+
+    auto start = std::chrono::steady_clock::now();
+    render();
+    auto end = std::chrono::steady_clock::now();
+
+    std::cout.rdbuf(old_buf);
+    return std::chrono::duration<double>(end - start).count();
+}
+
+
+template <typename Scene>
+void bench_scene(const std::string& name, Scene scene, int width, int spp, int batch_size) {
+    hittable_list world;
+    camera cam;
+    scene(world, cam);
+    cam.image_width = width;
+    cam.samples_per_pixel = spp;
+
+    // Integrador recursivo de camera.h
+    counting_hittable counted(world);
+    double recursive_seconds = timed_render("bench_" + name + "_recursive.ppm", [&] {
+        cam.render(counted);
+    });
+    double recursive_mrays = counted.count / recursive_seconds * 1e-6;
+
+    // Integrador wavefront
+    wavefront_renderer wavefront;
+    wavefront.batch_size = batch_size;
+    timed_render("bench_" + name + "_wavefront.ppm", [&] {
+        wavefront.render(cam, world);
+    });
+
+    std::cout << name << " (" << width << " px, " << spp << " spp)\n"
+              << "  recursivo: " << counted.count << " rayos, " << recursive_seconds << " s, "
+              << recursive_mrays << " Mrays/s\n"
+              << "  wavefront: " << wavefront.rays_traced << " rayos, " << wavefront.seconds
+              << " s, " << wavefront.mrays_per_second() << " Mrays/s (lote " << batch_size
+              << ", x" << wavefront.mrays_per_second() / recursive_mrays << ")\n";
+}
+
+
+// Render progresivo por tiles con cada orden de recorrido: rendimiento y fallos de cach
+template <typename Scene>
+void bench_traversal(const std::string& name, Scene scene, int width, int spp, int tile_size) {
+    hittable_list world;
+    camera cam;
+    scene(world, cam);
+    cam.image_width = width;
+    cam.samples_per_pixel = spp;
+
+    std::cout << name << " (" << width << " px, " << spp << " spp, tiles de " << tile_size
+              << ")\n";
+
+    auto orders = {traversal_order::scanline, traversal_order::morton, traversal_order::hilbert};
+    for (auto order : orders) {
+        counting_hittable counted(world);
+        progressive_renderer renderer;
+        renderer.samples_per_pass = spp;
+        renderer.tile_size = tile_size;
+        renderer.order = order;
+        renderer.show_progress = false;
+
+        cache_miss_counter misses;
+        misses.start();
+        auto start = std::chrono::steady_clock::now();
+        renderer.render(cam, counted);
+        auto end = std::chrono::steady_clock::now();
+        long long miss_count = misses.stop();
+        double seconds = std::chrono::duration<double>(end - start).count();
+
+        std::cout << "  " << traversal_order_name(order) << ": " << seconds << " s, "
+                  << counted.count / seconds * 1e-6 << " Mrays/s, fallos de cach: ";
+        if (miss_count < 0)
+            std::cout << "n/d\n";
+        else
+            std::cout << miss_count << " (" << double(miss_count) / counted.count << " por rayo)\n";
+    }
+}
+
+
+// Uso: benchmark [ancho] [muestras] [lote] [tile]
+int main(int argc, char* argv[]) {
+    int width      = argc > 1 ? std::atoi(argv[1]) : 200;
+    int spp        = argc > 2 ? std::atoi(argv[2]) : 16;
+    int batch_size = argc > 3 ? std::atoi(argv[3]) : 65536;
+    int tile_size  = argc > 4 ? std::atoi(argv[4]) : 32;
+
+    bench_scene("cubo", cube_scene, width, spp, batch_size);
+    bench_scene("cubos_mixtos", mixed_cubes_scene, width, spp, batch_size);
+
+    bench_traversal("cubos_mixtos", mixed_cubes_scene, width, spp, tile_size);
+}
@@ -11,6 +11,7 @@
 // along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
 //==============================================================================================
 
+#include "framebuffer.h"
 #include "hittable.h"
 #include "material.h"
 
@@ -50,16 +51,52 @@ class camera {
         std::clog << "\rDone.                 \n";
     }
 
-  private:
-    int    image_height;         // Rendered image height
-    double pixel_samples_scale;  // Color scale factor for a sum of pixel samples
-    point3 center;               // Camera center
-    point3 pixel00_loc;          // Location of pixel 0, 0
-    vec3   pixel_delta_u;        // Offset to pixel to the right
-    vec3   pixel_delta_v;        // Offset to pixel below
-    vec3   u, v, w;              // Camera frame basis vectors
-    vec3   defocus_disk_u;       // Defocus disk horizontal radius
-    vec3   defocus_disk_v;       // Defocus disk vertical radius
+    void render(const hittable& world, framebuffer& fb) {
+        // Renders into float buffers instead of std::cout, recording the first-hit AOVs too.
+        initialize();
+        fb.resize(image_width, image_height);
+
+        for (int j = 0; j < image_height; j++) {
+            std::clog << "\rScanlines remaining: " << (image_height - j) << ' ' << std::flush;
+            for (int i = 0; i < image_width; i++)
+                for (int sample = 0; sample < samples_per_pixel; sample++)
+                    add_sample(i, j, world, fb);
+        }
+
+        std::clog << "\rDone.                 \n";
+    }
+
+    void add_sample(int i, int j, const hittable& world, framebuffer& fb) const {
+        // Traces one sample of pixel i, j into the framebuffer. The primary hit is unrolled
+        // from ray_color so its albedo, normal and distance can be recorded.
+        auto p = fb.index(i, j);
+        ray r = get_ray(i, j);
+        hit_record rec;
+
+        fb.samples[p]++;
+        if (max_depth <= 0)
+            return;
+
+        if (world.hit(r, interval(0.001, infinity), rec)) {
+            fb.albedo[p] += rec.mat->aov_albedo();
+            fb.normal[p] += rec.normal;
+            fb.depth[p]  += rec.t * r.direction().length();
+
+            ray scattered;
+            color attenuation;
+            if (rec.mat->scatter(r, rec, attenuation, scattered))
+                fb.beauty[p] += attenuation * ray_color(scattered, max_depth-1, world);
+            return;
+        }
+
+        // The sky is its own albedo, so demodulated sky pixels are flat.
+        auto sky = background(r);
+        fb.beauty[p] += sky;
+        fb.albedo[p] += sky;
+        fb.normal[p] += -unit_vector(r.direction());
+    }
+
+    int height() const { return image_height; }
 
     void initialize() {
         image_height = int(image_width / aspect_ratio);
@@ -98,11 +135,15 @@ class camera {
         defocus_disk_v = v * defocus_radius;
     }
 
+    // Ray generation shared by the integrators in this directory (see wavefront.h).
     ray get_ray(int i, int j) const {
         // Construct a camera ray originating from the defocus disk and directed at a randomly
         // sampled point around the pixel location i, j.
+        return get_ray(i, j, sample_square());
+    }
 
-        auto offset = sample_square();
+    ray get_ray(int i, int j, const vec3& offset) const {
+        // Same, through the point at offset (in [-.5,+.5] pixel units) from the pixel center.
         auto pixel_sample = pixel00_loc
                           + ((i + offset.x()) * pixel_delta_u)
                           + ((j + offset.y()) * pixel_delta_v);
@@ -113,6 +154,61 @@ class camera {
         return ray(ray_origin, ray_direction);
     }
 
+    bool project(const point3& p, double& i, double& j) const {
+        // Inverse of get_ray for a pinhole camera: the continuous pixel coordinates, with pixel
+        // centers at integers, where the ray from the camera center to p crosses the viewport.
+        // Returns false for points behind the camera.
+        auto d = p - center;
+        auto along = dot(d, -w);
+        if (along <= 0)
+            return false;
+
+        auto q = d * (focus_dist / along) - (pixel00_loc - center);
+        i = dot(q, pixel_delta_u) / pixel_delta_u.length_squared();
+        j = dot(q, pixel_delta_v) / pixel_delta_v.length_squared();
+        return true;
+    }
+
+    color ray_color(const ray& r, int depth, const hittable& world) const {
+        // If we've exceeded the ray bounce limit, no more light is gathered.
+        if (depth <= 0)
+            return color(0,0,0);
+
+        hit_record rec;
+
+        if (world.hit(r, interval(0.001, infinity), rec))
+            return shade(r, rec, depth, world);
+
+        return background(r);
+    }
+
+    color shade(const ray& r, const hit_record& rec, int depth, const hittable& world) const {
+        // Radiance leaving the hit rec back along r, with depth bounces left including this one.
+        ray scattered;
+        color attenuation;
+        if (rec.mat->scatter(r, rec, attenuation, scattered))
+            return attenuation * ray_color(scattered, depth-1, world);
+        return color(0,0,0);
+    }
+
+    static color background(const ray& r) {
+        // Sky gradient seen by rays that escape the scene.
+        vec3 unit_direction = unit_vector(r.direction());
+        auto a = 0.5*(unit_direction.y() + 1.0);
+        return (1.0-a)*color(1.0, 1.0, 1.0) + a*color(0.5, 0.7, 1.0);
+    }
+
+  private:
+    int    image_height;         // Rendered image height
+    double pixel_samples_scale;  // Color scale factor for a sum of pixel samples
+    point3 center;               // Camera center
+    point3 pixel00_loc;          // Location of pixel 0, 0
+    vec3   pixel_delta_u;        // Offset to pixel to the right
+    vec3   pixel_delta_v;        // Offset to pixel below
+    vec3   u, v, w;              // Camera frame basis vectors
+    vec3   defocus_disk_u;       // Defocus disk horizontal radius
+    vec3   defocus_disk_v;       // Defocus disk vertical radius
+
     vec3 sample_square() const {
         // Returns the vector to a random point in the [-.5,-.5]-[+.5,+.5] unit square.
         return vec3(random_double() - 0.5, random_double() - 0.5, 0);
@@ -128,26 +224,6 @@ class camera {
         auto p = random_in_unit_disk();
         return center + (p[0] * defocus_disk_u) + (p[1] * defocus_disk_v);
     }
-
-    color ray_color(const ray& r, int depth, const hittable& world) const {
-        // If we've exceeded the ray bounce limit, no more light is gathered.
-        if (depth <= 0)
-            return color(0,0,0);
-
-        hit_record rec;
-
-        if (world.hit(r, interval(0.001, infinity), rec)) {
-            ray scattered;
-            color attenuation;
-            if (rec.mat->scatter(r, rec, attenuation, scattered))
-                return attenuation * ray_color(scattered, depth-1, world);
-            return color(0,0,0);
-        }
-
-        vec3 unit_direction = unit_vector(r.direction());
-        auto a = 0.5*(unit_direction.y() + 1.0);
-        return (1.0-a)*color(1.0, 1.0, 1.0) + a*color(0.5, 0.7, 1.0);
-    }
 };
 
 
@@ -0,0 +1,151 @@
+#ifndef DENOISER_H
+#define DENOISER_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include "framebuffer.h"
+#include "parallel.h"
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+
+// Edge-avoiding a-trous wavelet filter (Dammertz et al. 2010) guided by the first-hit AOVs.
+// The beauty image is divided by the albedo so texture and material edges survive, filtered
+// with a 5x5 B3-spline kernel whose taps spread out by a factor of two every iteration, and
+// multiplied back. Taps are weighted down where color, normal or depth differ from the center.
+//
+// The working buffers are planar floats and every kernel tap is applied as a loop over a
+// contiguous row span, so the inner loops are branch free and vectorize; rows are filtered in
+// parallel.
+class atrous_denoiser {
+  public:
+    int   iterations   = 5;      // Filter passes; pass k spaces its taps 2^k pixels apart
+    float sigma_color  = 0.6f;   // Edge stopping on demodulated color, halved every pass
+    float sigma_normal = 0.3f;   // Edge stopping on the normal difference
+    float sigma_depth  = 0.05f;  // Edge stopping on depth, relative to the center depth
+
+    std::vector<color> denoise(const framebuffer& fb) const {
+        int    w = fb.width;
+        int    h = fb.height;
+        size_t n = size_t(w) * h;
+
+        std::vector<float> col[3], tmp[3], nrm[3], dep(n);
+        std::vector<color> albedo(n);
+        for (int k = 0; k < 3; k++) {
+            col[k].resize(n);
+            tmp[k].resize(n);
+            nrm[k].resize(n);
+        }
+
+        for (size_t p = 0; p < n; p++) {
+            albedo[p] = fb.albedo_at(p);
+            auto c  = fb.beauty_at(p);
+            auto nv = fb.normal_at(p);
+            for (int k = 0; k < 3; k++) {
+                col[k][p] = float(c[k] / std::fmax(albedo[p][k], 1e-3));
+                nrm[k][p] = float(nv[k]);
+            }
+            dep[p] = float(fb.depth_at(p));
+        }
+
+        for (int it = 0; it < iterations; it++) {
+            int   step    = 1 << it;
+            float sigma_c = sigma_color / float(step);
+
+            parallel_for(h, [&](int y) {
+                filter_row(y, step, sigma_c, w, h, col, nrm, dep, tmp);
+            });
+            for (int k = 0; k < 3; k++)
+                std::swap(col[k], tmp[k]);
+        }
+
+        std::vector<color> pixels(n);
+        for (size_t p = 0; p < n; p++) {
+            for (int k = 0; k < 3; k++)
+                pixels[p][k] = col[k][p] * std::fmax(albedo[p][k], 1e-3);
+        }
+        return pixels;
+    }
+
+  private:
+    void filter_row(
+        int y, int step, float sigma_c, int w, int h, const std::vector<float> (&col)[3],
+        const std::vector<float> (&nrm)[3], const std::vector<float>& dep,
+        std::vector<float> (&out)[3]
+    ) const {
+        static const float kernel[5] = { 1.0f/16, 1.0f/4, 3.0f/8, 1.0f/4, 1.0f/16 };
+
+        float inv_c = 1.0f / (sigma_c * sigma_c);
+        float inv_n = 1.0f / (sigma_normal * sigma_normal);
+
+        std::vector<float> sum_r(w, 0.0f), sum_g(w, 0.0f), sum_b(w, 0.0f), sum_w(w, 0.0f);
+        std::vector<float> inv_z(w);
+
+        const size_t row = size_t(y) * w;
+        for (int x = 0; x < w; x++)
+            inv_z[x] = 1.0f / (sigma_depth * step * std::fmax(dep[row + x], 1e-4f));
+
+        for (int ky = 0; ky < 5; ky++) {
+            int yy = y + (ky - 2) * step;
+            if (yy < 0 || yy >= h)
+                continue;
+
+            for (int kx = 0; kx < 5; kx++) {
+                // Taps falling outside the image are skipped, which keeps [x0, x1) contiguous.
+                int off = (kx - 2) * step;
+                int x0  = std::max(0, -off);
+                int x1  = std::min(w, w - off);
+                float k = kernel[kx] * kernel[ky];
+
+                const float* cr = col[0].data() + row;
+                const float* cg = col[1].data() + row;
+                const float* cb = col[2].data() + row;
+                const float* nx = nrm[0].data() + row;
+                const float* ny = nrm[1].data() + row;
+                const float* nz = nrm[2].data() + row;
+                const float* zp = dep.data() + row;
+
+                size_t tap = size_t(yy) * w + off;
+                const float* qr = col[0].data() + tap;
+                const float* qg = col[1].data() + tap;
+                const float* qb = col[2].data() + tap;
+                const float* mx = nrm[0].data() + tap;
+                const float* my = nrm[1].data() + tap;
+                const float* mz = nrm[2].data() + tap;
+                const float* zq = dep.data() + tap;
+
+                for (int x = x0; x < x1; x++) {
+                    float dr = cr[x] - qr[x], dg = cg[x] - qg[x], db = cb[x] - qb[x];
+                    float ex = nx[x] - mx[x], ey = ny[x] - my[x], ez = nz[x] - mz[x];
+                    float dz = std::fabs(zp[x] - zq[x]) * inv_z[x];
+
+                    float weight = k * std::exp(-(dr*dr + dg*dg + db*db) * inv_c
+                                                - (ex*ex + ey*ey + ez*ez) * inv_n
+                                                - dz);
+                    sum_r[x] += weight * qr[x];
+                    sum_g[x] += weight * qg[x];
+                    sum_b[x] += weight * qb[x];
+                    sum_w[x] += weight;
+                }
+            }
+        }
+
+        // The center tap always has weight 9/64, so sum_w is never zero.
+        for (int x = 0; x < w; x++) {
+            out[0][row + x] = sum_r[x] / sum_w[x];
+            out[1][row + x] = sum_g[x] / sum_w[x];
+            out[2][row + x] = sum_b[x] / sum_w[x];
+        }
+    }
+};
+
+
+#endif
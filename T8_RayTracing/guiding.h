@@ -0,0 +1,389 @@
+#ifndef GUIDING_H
+#define GUIDING_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include "camera.h"
+#include "framebuffer.h"
+#include "hittable.h"
+#include "material.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+// Point of the unit square. Directions map to it with an area-preserving cylindrical
+// projection: u = (y + 1) / 2, v = azimuth / 2pi, so a density over the square divided by 4pi
+// is a density over solid angle.
+struct square_point {
+    double u, v;
+};
+
+inline square_point direction_to_square(const vec3& d) {
+    double phi = std::atan2(d.z(), d.x());
+    if (phi < 0)
+        phi += 2*pi;
+    return {std::clamp((d.y() + 1) / 2, 0.0, 1.0), std::min(phi / (2*pi), 1 - 1e-9)};
+}
+
+inline vec3 square_to_direction(const square_point& s) {
+    double y = 2*s.u - 1;
+    double r = std::sqrt(std::max(0.0, 1 - y*y));
+    double phi = 2*pi * s.v;
+    return vec3(r * std::cos(phi), y, r * std::sin(phi));
+}
+
+
+// Directional quadtree: a piecewise-constant density over the square that is refined where
+// energy concentrates. Each node stores the energy recorded in its four quadrants; record()
+// may be called from several threads while the structure stays fixed.
+class dtree {
+  public:
+    dtree() : nodes(1, {0, 0, 0, 0}), sums(4) { clear(); }
+
+    dtree(const dtree& other) : nodes(other.nodes), sums(other.sums.size()) {
+        for (size_t i = 0; i < sums.size(); i++)
+            sums[i] = other.sums[i].load();
+    }
+
+    dtree& operator=(const dtree& other) {
+        nodes = other.nodes;
+        sums = std::vector<std::atomic<float>>(other.sums.size());
+        for (size_t i = 0; i < sums.size(); i++)
+            sums[i] = other.sums[i].load();
+        return *this;
+    }
+
+    void clear() {
+        for (auto& s : sums)
+            s = 0;
+    }
+
+    double total() const { return double(sums[0]) + sums[1] + sums[2] + sums[3]; }
+
+    void record(square_point s, float value) {
+        for (int n = 0; ; ) {
+            int c = quadrant(s);
+            add(sums[n*4 + c], value);
+            if (!nodes[n][c])
+                return;
+            n = nodes[n][c];
+        }
+    }
+
+    double pdf(square_point s) const {
+        // Density over the unit square; uniform where nothing was recorded.
+        double p = 1;
+        for (int n = 0; ; ) {
+            double t = sums[n*4] + sums[n*4+1] + sums[n*4+2] + sums[n*4+3];
+            if (t <= 0)
+                return p;
+            int c = quadrant(s);
+            p *= 4 * sums[n*4 + c] / t;
+            if (!nodes[n][c])
+                return p;
+            n = nodes[n][c];
+        }
+    }
+
+    square_point sample() const {
+        // Descends choosing quadrants in proportion to their energy, then picks a uniform
+        // point in the leaf reached.
+        double u0 = 0, v0 = 0, size = 1;
+        for (int n = 0; ; ) {
+            double e[4], t = 0;
+            for (int c = 0; c < 4; c++)
+                t += e[c] = sums[n*4 + c];
+
+            int c = 0;
+            if (t > 0) {
+                double x = random_double() * t;
+                while (c < 3 && x >= e[c])
+                    x -= e[c++];
+            } else {
+                c = int(random_double() * 4) & 3;
+            }
+
+            size /= 2;
+            u0 += (c & 1) * size;
+            v0 += (c >> 1) * size;
+            if (t <= 0 || !nodes[n][c])
+                return {u0 + random_double() * size, v0 + random_double() * size};
+            n = nodes[n][c];
+        }
+    }
+
+    dtree refined(double threshold, int max_depth) const {
+        // Empty tree whose leaves each hold less than threshold of this tree's energy, within
+        // max_depth levels: high-energy quadrants are split and low-energy subtrees collapse.
+        dtree out;
+        out.nodes.clear();
+        out.nodes.push_back({0, 0, 0, 0});
+        double t = total();
+        if (t > 0)
+            refine_node(0, t, out, 0, t, threshold, 1, max_depth);
+        out.sums = std::vector<std::atomic<float>>(out.nodes.size() * 4);
+        out.clear();
+        return out;
+    }
+
+  private:
+    std::vector<std::array<int,4>>  nodes;  // Child node of each quadrant, 0 for a leaf
+    std::vector<std::atomic<float>> sums;   // Energy of each quadrant, 4 per node
+
+    static void add(std::atomic<float>& target, float value) {
+        float old = target.load();
+        while (!target.compare_exchange_weak(old, old + value)) {}
+    }
+
+    static int quadrant(square_point& s) {
+        // Quadrant of s in the current node, rescaling s to that quadrant.
+        int c = 0;
+        if (s.u >= 0.5) { c |= 1; s.u -= 0.5; }
+        if (s.v >= 0.5) { c |= 2; s.v -= 0.5; }
+        s.u *= 2;
+        s.v *= 2;
+        return c;
+    }
+
+    void refine_node(int src, double energy, dtree& out, int dst, double total,
+                     double threshold, int depth, int max_depth) const {
+        // src is -1 below this tree's leaves, where energy is spread evenly.
+        for (int c = 0; c < 4; c++) {
+            double e = src >= 0 ? double(sums[src*4 + c]) : energy / 4;
+            if (depth >= max_depth || e / total <= threshold)
+                continue;
+
+            int child = int(out.nodes.size());
+            out.nodes.push_back({0, 0, 0, 0});
+            out.nodes[dst][c] = child;
+            int child_src = (src >= 0 && nodes[src][c]) ? nodes[src][c] : -1;
+            refine_node(child_src, e, out, child, total, threshold, depth + 1, max_depth);
+        }
+    }
+};
+
+
+// Spatial-directional tree (Mueller et al. 2017): a binary tree over the scene box, split
+// where many samples land, whose leaves hold a quadtree learned in the last pass (used for
+// sampling) and one being recorded in the current pass.
+//
+// Surfaces of different orientation in one leaf see different hemispheres, and a distribution
+// learned from all of them sends many samples below the surface. Each leaf therefore keeps a
+// pair of quadtrees per bin of a 5 x 5 octahedral map of the surface normal; the odd bin count
+// keeps the axis-aligned and 45-degree normals of the cubes away from bin edges.
+class sd_tree {
+  public:
+    static const int normal_bins = 5;
+
+    struct distribution {
+        dtree sampling;
+        dtree building;
+    };
+
+    struct leaf {
+        distribution     bins[normal_bins * normal_bins];
+        std::atomic<int> samples{0};
+
+        distribution& bin(const vec3& n) {
+            // Octahedral map of the unit normal n to [-1,1]^2.
+            double l1 = std::fabs(n.x()) + std::fabs(n.y()) + std::fabs(n.z());
+            double x = n.x() / l1, y = n.y() / l1;
+            if (n.z() < 0) {
+                double folded = (1 - std::fabs(y)) * (x >= 0 ? 1 : -1);
+                y = (1 - std::fabs(x)) * (y >= 0 ? 1 : -1);
+                x = folded;
+            }
+            int bx = std::clamp(int((x + 1) / 2 * normal_bins), 0, normal_bins - 1);
+            int by = std::clamp(int((y + 1) / 2 * normal_bins), 0, normal_bins - 1);
+            return bins[by * normal_bins + bx];
+        }
+    };
+
+    sd_tree(const point3& center, double half_size)
+      : center(center), half_size(half_size), nodes(1, {0, {0, 0}, 0}) {
+        leaves.push_back(std::make_unique<leaf>());
+    }
+
+    leaf& find(const point3& p) {
+        // Leaf containing p; points outside the box go to the nearest leaf.
+        point3 low = center - vec3(half_size, half_size, half_size);
+        vec3 size(2*half_size, 2*half_size, 2*half_size);
+        int n = 0;
+        while (nodes[n].leaf < 0) {
+            int axis = nodes[n].axis;
+            size[axis] /= 2;
+            int c = p[axis] >= low[axis] + size[axis];
+            if (c)
+                low[axis] += size[axis];
+            n = nodes[n].child[c];
+        }
+        return *leaves[nodes[n].leaf];
+    }
+
+    size_t leaf_count() const { return leaves.size(); }
+
+    void refine(int split_threshold, double energy_threshold, int max_depth) {
+        // Ends a training pass: splits crowded leaves, makes what was recorded the sampling
+        // distribution and starts a refined, empty recording tree.
+        for (size_t n = 0; n < nodes.size(); n++)
+            split(int(n), split_threshold);
+
+        for (auto& l : leaves) {
+            for (auto& d : l->bins) {
+                d.sampling = d.building;
+                d.building = d.sampling.refined(energy_threshold, max_depth);
+            }
+            l->samples = 0;
+        }
+    }
+
+  private:
+    struct node {
+        int axis;      // Axis split at the middle of the node's box, cycling x, y, z
+        int child[2];
+        int leaf;      // Index in leaves, -1 for inner nodes
+    };
+
+    point3 center;
+    double half_size;
+    std::vector<node>                  nodes;
+    std::vector<std::unique_ptr<leaf>> leaves;
+
+    void split(int n, int threshold) {
+        if (nodes[n].leaf < 0 || leaves[nodes[n].leaf]->samples <= threshold)
+            return;
+
+        // The old leaf becomes the first child, a copy of it the second; each keeps half the
+        // sample count so it splits again if it is still over the threshold.
+        int l = nodes[n].leaf;
+        int half = leaves[l]->samples / 2;
+        leaves[l]->samples = half;
+        auto copy = std::make_unique<leaf>();
+        for (int b = 0; b < normal_bins * normal_bins; b++)
+            copy->bins[b] = leaves[l]->bins[b];
+        copy->samples = half;
+        leaves.push_back(std::move(copy));
+
+        int axis = (nodes[n].axis + 1) % 3;
+        int first = int(nodes.size());
+        nodes.push_back({axis, {0, 0}, l});
+        nodes.push_back({axis, {0, 0}, int(leaves.size()) - 1});
+        nodes[n].leaf = -1;
+        nodes[n].child[0] = first;
+        nodes[n].child[1] = first + 1;
+    }
+};
+
+
+// Progressive path guiding. Training passes of 1, 2, 4, ... samples per pixel record, at every
+// lambertian vertex, the luminance of the incoming radiance times the cosine into the SD-tree;
+// between passes the tree is refined and what was learned becomes the sampling distribution.
+// At lambertian vertices the next direction comes from material::scatter with probability
+// bsdf_fraction and from the guide otherwise, weighted by the one-sample MIS density of both.
+// Training samples are unbiased too, so they are kept in fb along with the later passes.
+class guided_renderer {
+  public:
+    int    training_passes  = 5;      // Training passes, the last one with 2^(n-1) spp
+    double bsdf_fraction    = 0.5;    // Probability of sampling the material
+    int    split_threshold  = 12000;  // Samples per spatial leaf before it splits, times sqrt(spp)
+    double energy_threshold = 0.01;   // Energy fraction above which a quadrant is split
+    int    max_tree_depth   = 16;
+
+    sd_tree guide;
+    framebuffer fb;
+
+    guided_renderer(const point3& center, double half_size) : guide(center, half_size) {}
+
+    void train(camera& cam, const hittable& world) {
+        cam.initialize();
+        for (int pass = 0; pass < training_passes; pass++) {
+            render_pass(cam, world, 1 << pass, std::uint32_t(pass), true, fb);
+            guide.refine(int(split_threshold * std::sqrt(double(1 << pass))), energy_threshold,
+                         max_tree_depth);
+        }
+    }
+
+    void render(camera& cam, const hittable& world, int spp, std::uint32_t seed = 1000) {
+        // Adds spp guided samples per pixel to fb; seeds below training_passes are taken.
+        cam.initialize();
+        render_pass(cam, world, spp, seed, false, fb);
+    }
+
+  private:
+    static double luminance(const color& c) {
+        return 0.2126 * c.x() + 0.7152 * c.y() + 0.0722 * c.z();
+    }
+
+    void render_pass(const camera& cam, const hittable& world, int spp, std::uint32_t seed,
+                     bool record, framebuffer& out) {
+        if (out.width != cam.image_width || out.height != cam.height())
+            out.resize(cam.image_width, cam.height());
+
+        parallel_for(cam.height(), [&](int j) {
+            seed_random({seed, std::uint32_t(j)});
+            for (int i = 0; i < cam.image_width; i++) {
+                auto p = out.index(i, j);
+                for (int s = 0; s < spp; s++) {
+                    out.beauty[p] += radiance(cam.get_ray(i, j), cam.max_depth, world, record);
+                    out.samples[p]++;
+                }
+            }
+        });
+    }
+
+    color radiance(const ray& r, int depth, const hittable& world, bool record) {
+        if (depth <= 0)
+            return color(0,0,0);
+
+        hit_record rec;
+        if (!world.hit(r, interval(0.001, infinity), rec))
+            return camera::background(r);
+
+        ray scattered;
+        color attenuation;
+        if (!rec.mat->scatter(r, rec, attenuation, scattered))
+            return color(0,0,0);
+
+        if (rec.mat->kind() != material_kind::lambertian)
+            return attenuation * radiance(scattered, depth-1, world, record);
+
+        // One-sample MIS between the material's cosine lobe and the guide; bins that learned
+        // nothing yet sample the material only.
+        auto& l = guide.find(rec.p);
+        auto& d = l.bin(rec.normal);
+        double fraction = d.sampling.total() > 0 ? bsdf_fraction : 1.0;
+        vec3 direction = unit_vector(scattered.direction());
+        if (random_double() >= fraction)
+            direction = square_to_direction(d.sampling.sample());
+
+        double cosine = dot(rec.normal, direction);
+        if (cosine <= 0)
+            return color(0,0,0);
+
+        auto s = direction_to_square(direction);
+        double pdf = fraction * cosine / pi + (1 - fraction) * d.sampling.pdf(s) / (4*pi);
+        color incoming = radiance(ray(rec.p, direction), depth-1, world, record);
+
+        if (record) {
+            d.building.record(s, float(luminance(incoming) * cosine / pdf));
+            l.samples++;
+        }
+        return attenuation * (cosine / pi) * incoming / pdf;
+    }
+};
+
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include "camera.h"
+#include "framebuffer.h"
+#include "hittable_list.h"
+#include "parallel.h"
+#include "tiles.h"
+
+#include <cstdint>
+#include <vector>
+
+
+// Marks every object of the wrapped list that a ray hits. The camera calls hit() for the
+// primary ray and for every bounce, so this collects all objects a path depends on.
+class dependency_recorder : public hittable {
+  public:
+    dependency_recorder(const hittable_list& world, std::vector<bool>& hit_objects)
+      : world(world), hit_objects(hit_objects) {}
+
+    bool hit(const ray& r, interval ray_t, hit_record& rec) const override {
+        if (!world.hit(r, ray_t, rec))
+            return false;
+        if (rec.object >= 0 && rec.object < int(hit_objects.size()))
+            hit_objects[rec.object] = true;
+        return true;
+    }
+
+  private:
+    const hittable_list& world;
+    std::vector<bool>&   hit_objects;
+};
+
+
+// Keeps the accumulation buffers of the last render together with, per tile, the set of
+// objects hit by any of its paths. After an edit only the tiles that depend on the changed
+// objects are rendered again.
+//
+// Each tile reseeds the generator from (seed, tile), so a path that never touches a changed
+// object draws the same numbers and gives the same radiance as in a full render of the edited
+// scene. Material edits are therefore exact. An object that moves or grows can also start
+// blocking paths that never hit it before; for those, update() traces a low-sample probe of
+// the edited scene and adds the tiles whose probe paths hit the object. Paths the probe
+// misses keep their old value, so a moved object may leave a small residual error.
+class incremental_renderer {
+  public:
+    int           tile_size     = 32;  // Tile edge in pixels
+    std::uint32_t seed          = 1;   // Base seed of the per-tile generators
+    int           probe_samples = 1;   // Samples per pixel of the probe for moved objects
+
+    framebuffer fb;  // Accumulation of the last render or update
+
+    void render(camera& cam, const hittable_list& world) {
+        // Full render, recording every tile's dependency set.
+        cam.initialize();
+        fb.resize(cam.image_width, cam.height());
+        tiles = make_tiles(cam.image_width, cam.height(), tile_size);
+        tile_objects.assign(tiles.size(), std::vector<bool>(world.objects.size(), false));
+
+        parallel_for(int(tiles.size()), [&](int t) { render_tile(cam, world, t); });
+    }
+
+    int update(camera& cam, const hittable_list& world, const std::vector<int>& changed,
+               bool moved = false) {
+        // Re-renders the tiles affected by editing the objects at the given indices of world,
+        // which must be the list passed to render(). Set moved if an edit changed geometry.
+        // Returns the number of tiles rendered again.
+        cam.initialize();
+        for (auto& objects : tile_objects)
+            objects.resize(world.objects.size(), false);
+
+        std::vector<char> dirty(tiles.size(), 0);
+        for (size_t t = 0; t < tiles.size(); t++)
+            for (int k : changed)
+                if (tile_objects[t][k])
+                    dirty[t] = 1;
+
+        if (moved) {
+            parallel_for(int(tiles.size()), [&](int t) {
+                if (!dirty[t] && probe_hits(cam, world, t, changed))
+                    dirty[t] = 1;
+            });
+        }
+
+        std::vector<int> rerender;
+        for (size_t t = 0; t < tiles.size(); t++)
+            if (dirty[t])
+                rerender.push_back(int(t));
+
+        parallel_for(int(rerender.size()), [&](int n) { render_tile(cam, world, rerender[n]); });
+        return int(rerender.size());
+    }
+
+    int tile_count() const { return int(tiles.size()); }
+
+  private:
+    std::vector<tile>              tiles;
+    std::vector<std::vector<bool>> tile_objects;  // Objects hit by the paths of each tile
+
+    void render_tile(const camera& cam, const hittable_list& world, int t) {
+        const auto& tl = tiles[t];
+        for (int j = tl.y0; j < tl.y1; j++) {
+            for (int i = tl.x0; i < tl.x1; i++) {
+                auto p = fb.index(i, j);
+                fb.beauty[p] = fb.albedo[p] = fb.normal[p] = vec3(0,0,0);
+                fb.depth[p] = 0;
+                fb.samples[p] = 0;
+            }
+        }
+
+        auto& objects = tile_objects[t];
+        objects.assign(world.objects.size(), false);
+        dependency_recorder recorder(world, objects);
+
+        seed_random({seed, std::uint32_t(t)});
+        for (int j = tl.y0; j < tl.y1; j++)
+            for (int i = tl.x0; i < tl.x1; i++)
+                for (int s = 0; s < cam.samples_per_pixel; s++)
+                    cam.add_sample(i, j, recorder, fb);
+    }
+
+    bool probe_hits(const camera& cam, const hittable_list& world, int t,
+                    const std::vector<int>& changed) const {
+        // Traces probe_samples paths per pixel through the edited scene and reports whether
+        // any of them hits a changed object.
+        std::vector<bool> objects(world.objects.size(), false);
+        dependency_recorder recorder(world, objects);
+
+        const auto& tl = tiles[t];
+        seed_random({seed, std::uint32_t(t), 1});
+        for (int j = tl.y0; j < tl.y1; j++)
+            for (int i = tl.x0; i < tl.x1; i++)
+                for (int s = 0; s < probe_samples; s++)
+                    cam.ray_color(cam.get_ray(i, j), cam.max_depth, recorder);
+
+        for (int k : changed)
+            if (objects[k])
+                return true;
+        return false;
+    }
+};
+
+
+#endif
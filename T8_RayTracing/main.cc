@@ -1,45 +1,275 @@
 
 #include "rtweekend.h"
 
+#include "batch.h"
 #include "camera.h"
+#include "denoiser.h"
+#include "framebuffer.h"
 #include "hittable.h"
 #include "hittable_list.h"
+#include "irradiance_cache.h"
 #include "material.h"
-#include "sphere.h"
-#include "box.h"
+#include "preview.h"
+#include "progressive.h"
+#include "scenes.h"
+#include "server.h"
+#include "tiled_image.h"
+#include "visibility.h"
+#include "wavefront.h"
 
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+
+// Valor de una opcin "--nombre valor" en cualquier posicin de la lnea de comandos
+std::string option(int argc, char* argv[], const std::string& name, const std::string& fallback) {
+    for (int a = 1; a + 1 < argc; a++)
+        if (name == argv[a])
+            return argv[a + 1];
+    return fallback;
+}
 
-int main() {
-    hittable_list world;
 
-    // Material para el suelo (gris claro)
-    auto material_ground = make_shared<lambertian>(color(0.8, 0.8, 0.0));
+int main(int argc, char* argv[]) {
+    std::string mode = argc > 1 ? argv[1] : "";
 
-    // Material para el cubo (azulado, como la esfera original de la Imagen 10)
-    auto material_cube = make_shared<lambertian>(color(0.1, 0.2, 0.5));
+    // --server [puerto]: servidor de render que mantiene las escenas cargadas entre pedidos.
+    // Sin puerto atiende la entrada estndar, una peticin por lnea, por ejemplo:
+    //   render cubo width=200 spp=16 from=0,0,1 at=0,0,-1
+    // La respuesta "ok <bytes>" va seguida de la imagen PPM (ver server.h).
+    if (mode == "--server") {
+        render_server server;
+        server.add_scene("cubo", cube_scene);
+        server.add_scene("cubos_mixtos", mixed_cubes_scene);
 
-    // Aadir suelo (una esfera grande)
-    world.add(make_shared<sphere>(point3(0, -100.5, -1.0), 100.0, material_ground));
+        if (argc < 3) {
+            server.serve(std::cin, std::cout);
+            return 0;
+        }
 
-    // Aadir cubo en lugar de la esfera
-    world.add(make_shared<box>(
-        point3(-0.5, -0.5, -1.7),  // Esquina mnima
-        point3(0.5, 0.5, -0.7),    // Esquina mxima
-        material_cube
-    ));
+        net_startup();
+        // solo conexiones locales: el servidor no tiene autenticacin
+        socket_t listener = listen_tcp(std::atoi(argv[2]), INADDR_LOOPBACK);
+        if (listener == invalid_socket) {
+            std::cerr << "No se pudo escuchar en el puerto " << argv[2] << '\n';
+            return 1;
+        }
+        server.serve(listener);
+    }
 
-    // Configuracin de la cmara para una vista simple
+    // --assemble archivo [factor]: escribe en PPM una imagen guardada por tiles con --tiled,
+    // reducida por factor en cada eje, leyendo el archivo por filas.
+    if (mode == "--assemble" && argc > 2) {
+        int factor = argc > 3 ? std::atoi(argv[3]) : 1;
+        return write_tiled_ppm(argv[2], std::cout, factor) ? 0 : 1;
+    }
+
+    hittable_list world;
     camera cam;
-    cam.aspect_ratio = 16.0 / 9.0;
-    cam.image_width = 400;        // Resolucin menor para renderizado ms rpido
-    cam.samples_per_pixel = 100;  // Ms samples para mejor calidad
-    cam.max_depth = 50;
-    cam.vfov = 20;
-    cam.lookfrom = point3(0, 0, 1);  // Ms cerca para ver bien el cubo
-    cam.lookat = point3(0, 0, -1);
-    cam.vup = vec3(0, 1, 0);
-    cam.defocus_angle = 0;  // Sin desenfoque
-    cam.focus_dist = 10.0;
-
-    cam.render(world);
+    cube_scene(world, cam);
+
+    // --turntable cuadros [prefijo]: vuelta completa de la cmara alrededor de lookat, un
+    // archivo prefijo_NNN.ppm por cuadro. Todos los cuadros se renderizan con la misma
+    // escena y el mismo pool de hilos, intercalando tiles de varios cuadros (ver batch.h).
+    if (mode == "--turntable" && argc > 2) {
+        std::string prefix = argc > 3 ? argv[3] : "turntable";
+        auto cameras = turntable(cam, std::atoi(argv[2]));
+
+        thread_pool pool;
+        batch_renderer batch(pool);
+        batch.on_frame = [&](int frame, const framebuffer& fb) {
+            char name[16];
+            std::snprintf(name, sizeof(name), "_%03d.ppm", frame);
+            std::ofstream out(prefix + name);
+            fb.write_ppm(out, fb.resolve());
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        batch.render(cameras, world);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::clog << cameras.size() << " cuadros en " << seconds << " s, "
+                  << pool.size() << " hilos\n";
+        return 0;
+    }
+
+    // --tiled archivo ancho [muestras]: render directo a un archivo por tiles (ver
+    // tiled_image.h); en memoria solo estn los tiles en curso, as que sirve para
+    // resoluciones que no caben en RAM.
+    if (mode == "--tiled" && argc > 3) {
+        cam.image_width = std::atoi(argv[3]);
+        if (argc > 4)
+            cam.samples_per_pixel = std::atoi(argv[4]);
+        return render_tiled(cam, world, argv[2]) ? 0 : 1;
+    }
+
+    // --wavefront [lote]: renderiza por lotes de rayos ordenados por material
+    if (mode == "--wavefront") {
+        wavefront_renderer renderer;
+        if (argc > 2)
+            renderer.batch_size = std::atoi(argv[2]);
+        renderer.render(cam, world);
+        return 0;
+    }
+
+    // --progressive archivo [segundos]: render por pasadas con checkpoints en el archivo.
+    // Si el archivo ya existe se contina desde l; al agotarse el tiempo se escribe la
+    // mejor imagen hasta el momento. Con --order scanline|morton|hilbert se elige el orden
+    // de recorrido de tiles y pixeles.
+    if (mode == "--progressive" && argc > 2) {
+        progressive_renderer renderer;
+        renderer.checkpoint_path = argv[2];
+        renderer.order = traversal_order_from_name(option(argc, argv, "--order", "scanline"));
+        if (argc > 3)
+            renderer.time_budget = std::atof(argv[3]);
+        if (renderer.load_checkpoint(cam))
+            std::clog << "Resuming at pass " << renderer.pass << ", tile " << renderer.next_tile << '\n';
+
+        renderer.render(cam, world);
+        renderer.fb.write_ppm(std::cout, renderer.fb.resolve());
+        return 0;
+    }
+
+    // --preview [ms]: vista previa con presupuesto de tiempo, un archivo preview_NNN.ppm por
+    // refinamiento. Despus lee nuevas vistas de la entrada estndar, una por lnea:
+    //   lookfrom_x lookfrom_y lookfrom_z lookat_x lookat_y lookat_z vfov
+    // La escena no se reconstruye; solo se reinicializa la cmara.
+    if (mode == "--preview") {
+        preview_renderer preview(cam, world);
+        if (argc > 2)
+            preview.budget_ms = std::atof(argv[2]);
+        preview.on_frame = [](const std::vector<color>& pixels, int width, int height, int frame) {
+            char name[32];
+            std::snprintf(name, sizeof(name), "preview_%03d.ppm", frame);
+            std::ofstream out(name);
+            framebuffer fb;
+            fb.width  = width;
+            fb.height = height;
+            fb.write_ppm(out, pixels);
+        };
+
+        std::clog << preview.render() << " frames\n";
+
+        point3 from, at;
+        double vfov;
+        while (std::cin >> from[0] >> from[1] >> from[2] >> at[0] >> at[1] >> at[2] >> vfov) {
+            preview.look(from, at, vfov);
+            std::clog << preview.render() << " frames\n";
+        }
+        return 0;
+    }
+
+    // --visibility: compara el render con buffer de visibilidad (impactos primarios
+    // calculados una vez por posicin del patrn de jitter) contra trazar cada rayo primario.
+    // Solo para cmaras sin desenfoque.
+    if (mode == "--visibility") {
+        visibility_renderer traced, buffered;
+        traced.use_buffer = false;
+        if (!traced.render(cam, world) || !buffered.render(cam, world)) {
+            std::cerr << "El buffer de visibilidad requiere defocus_angle == 0\n";
+            return 1;
+        }
+
+        double traced_time = traced.shading_seconds;
+        double buffered_time = buffered.visibility_seconds + buffered.shading_seconds;
+        int different = 0;
+        for (size_t p = 0; p < traced.fb.beauty.size(); p++)
+            different += (traced.fb.beauty[p] - buffered.fb.beauty[p]).length_squared() > 0;
+
+        std::clog << "Rayos primarios trazados: " << traced_time << " s\n"
+                  << "Buffer de visibilidad:    " << buffered_time << " s ("
+                  << buffered.visibility_seconds << " s de visibilidad)\n"
+                  << "Aceleracin: " << traced_time / buffered_time << "x, pixeles distintos: "
+                  << different << '\n';
+        buffered.fb.write_ppm(std::cout, buffered.fb.resolve());
+        return 0;
+    }
+
+    // --irradiance [error]: tiempo contra calidad del cache de irradiancia frente a fuerza
+    // bruta. Ambos se miden con el RMSE respecto a una referencia de 256 muestras.
+    if (mode == "--irradiance") {
+        using clock = std::chrono::steady_clock;
+        auto seconds_since = [](clock::time_point start) {
+            return std::chrono::duration<double>(clock::now() - start).count();
+        };
+        auto brute_force = [&](int spp, framebuffer& fb) {
+            cam.samples_per_pixel = spp;
+            cam.initialize();
+            fb.resize(cam.image_width, cam.height());
+            parallel_for(cam.height(), [&](int j) {
+                seed_random({std::uint32_t(spp), std::uint32_t(j)});
+                for (int i = 0; i < cam.image_width; i++)
+                    for (int s = 0; s < spp; s++) {
+                        fb.beauty[fb.index(i, j)] += cam.ray_color(cam.get_ray(i, j), cam.max_depth, world);
+                        fb.samples[fb.index(i, j)]++;
+                    }
+            });
+        };
+        auto rmse = [](const framebuffer& a, const framebuffer& b) {
+            double sum = 0;
+            for (size_t p = 0; p < a.beauty.size(); p++)
+                sum += (a.beauty_at(p) - b.beauty_at(p)).length_squared() / 3;
+            return std::sqrt(sum / a.beauty.size());
+        };
+
+        framebuffer reference;
+        brute_force(256, reference);
+
+        for (int spp : {4, 16, 64}) {
+            framebuffer fb;
+            auto start = clock::now();
+            brute_force(spp, fb);
+            std::clog << "Fuerza bruta " << spp << " spp: " << seconds_since(start) << " s, RMSE "
+                      << rmse(fb, reference) << '\n';
+        }
+
+        framebuffer cached;
+        for (int spp : {1, 4}) {
+            irradiance_cache cache(point3(0,0,0), 4);
+            if (argc > 2)
+                cache.error = std::atof(argv[2]);
+            cam.samples_per_pixel = spp;
+
+            auto start = clock::now();
+            render_irradiance_cached(cam, world, cache, cached);
+            std::clog << "Cache de irradiancia " << spp << " spp: " << seconds_since(start) << " s, RMSE "
+                      << rmse(cached, reference) << ", " << cache.size() << " registros\n";
+        }
+
+        cached.write_ppm(std::cout, cached.resolve());
+        return 0;
+    }
+
+    // --reference: render directo a 100 muestras, sin denoiser
+    if (mode == "--reference") {
+        cam.render(world);
+        return 0;
+    }
+
+    // Por defecto: 8 muestras por pixel y denoiser guiado por albedo, normal y profundidad.
+    // Con --aov se guardan ademas los buffers auxiliares para revisarlos.
+    cam.samples_per_pixel = 8;
+
+    framebuffer fb;
+    cam.render(world, fb);
+
+    atrous_denoiser denoiser;
+    fb.write_ppm(std::cout, denoiser.denoise(fb));
+
+    if (mode == "--aov") {
+        std::vector<color> albedo, normal, depth;
+        for (size_t p = 0; p < fb.beauty.size(); p++) {
+            albedo.push_back(fb.albedo_at(p));
+            normal.push_back(0.5 * (fb.normal_at(p) + vec3(1,1,1)));
+            depth.push_back(vec3(1,1,1) * (fb.depth_at(p) / (1 + fb.depth_at(p))));
+        }
+        std::ofstream albedo_out("aov_albedo.ppm"), normal_out("aov_normal.ppm");
+        std::ofstream depth_out("aov_depth.ppm");
+        fb.write_ppm(albedo_out, albedo);
+        fb.write_ppm(normal_out, normal);
+        fb.write_ppm(depth_out, depth);
+    }
 }
@@ -0,0 +1,171 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+inline int thread_count() {
+    // Number of worker threads used by parallel_for.
+    int n = int(std::thread::hardware_concurrency());
+    return n > 0 ? n : 1;
+}
+
+template <typename Body>
+void parallel_for(int count, Body body) {
+    // Calls body(i) for every i in [0, count). Indices are handed out in increasing order to
+    // whichever thread is free, so neighbouring indices run at about the same time.
+    std::atomic<int> next{0};
+    auto worker = [&] {
+        for (int i = next++; i < count; i = next++)
+            body(i);
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < std::min(thread_count(), count); t++)
+        threads.emplace_back(worker);
+    worker();
+
+    for (auto& thread : threads)
+        thread.join();
+}
+
+template <typename Predicate, typename Body>
+int parallel_for_while(int count, Predicate keep_going, Body body) {
+    // Like parallel_for, but threads stop taking new indices once keep_going() returns false.
+    // Every index that was taken is finished, so on return exactly [0, n) has run, where n is
+    // the returned value.
+    std::atomic<int> next{0};
+    auto worker = [&] {
+        while (keep_going()) {
+            int i = next++;
+            if (i >= count)
+                break;
+            body(i);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < std::min(thread_count(), count); t++)
+        threads.emplace_back(worker);
+    worker();
+
+    for (auto& thread : threads)
+        thread.join();
+
+    return std::min(int(next), count);
+}
+
+
+// Fixed set of threads kept alive between renders. parallel_for may be called from several
+// threads at once: each call queues its own batch, the pool threads help whichever batches are
+// queued, and the calling thread works on its own batch until every index has finished.
+class thread_pool {
+  public:
+    explicit thread_pool(int threads = thread_count()) {
+        for (int t = 1; t < threads; t++)
+            workers.emplace_back([this] { work(); });
+    }
+
+    ~thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    int size() const { return int(workers.size()) + 1; }
+
+    template <typename Body>
+    void parallel_for(int count, Body body) {
+        // Calls body(i) for every i in [0, count), like the free parallel_for.
+        if (count <= 0)
+            return;
+
+        auto b = std::make_shared<batch>();
+        b->count = count;
+        b->body  = [&body](int i) { body(i); };
+
+        // One entry per helper; entries popped after the batch is done return immediately.
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (int t = 0; t < std::min(int(workers.size()), count - 1); t++)
+                queue.push_back(b);
+        }
+        wake.notify_all();
+
+        run(*b);
+        std::unique_lock<std::mutex> lock(b->mutex);
+        b->done.wait(lock, [&] { return b->finished == b->count; });
+    }
+
+  private:
+    struct batch {
+        int                      count = 0;
+        std::function<void(int)> body;
+        std::atomic<int>         next{0};
+        int                      finished = 0;  // Guarded by mutex
+        std::mutex               mutex;
+        std::condition_variable  done;
+    };
+
+    std::vector<std::thread>           workers;
+    std::deque<std::shared_ptr<batch>> queue;
+    std::mutex                         mutex;
+    std::condition_variable            wake;
+    bool                               stopping = false;
+
+    static void run(batch& b) {
+        int ran = 0;
+        for (int i = b.next++; i < b.count; i = b.next++) {
+            b.body(i);
+            ran++;
+        }
+        if (ran == 0)
+            return;
+
+        std::lock_guard<std::mutex> lock(b.mutex);
+        b.finished += ran;
+        if (b.finished == b.count)
+            b.done.notify_all();
+    }
+
+    void work() {
+        for (;;) {
+            std::shared_ptr<batch> b;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || !queue.empty(); });
+                if (queue.empty())
+                    return;
+                b = std::move(queue.front());
+                queue.pop_front();
+            }
+            run(*b);
+        }
+    }
+};
+
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef PREVIEW_H
+#define PREVIEW_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include "camera.h"
+#include "framebuffer.h"
+#include "progressive.h"
+
+#include <chrono>
+#include <functional>
+#include <vector>
+
+
+// Interactive framing mode. render() returns within a fixed time budget: it starts with a
+// 1 spp image at a fraction of image_width, doubles the resolution until it reaches the full
+// width, then keeps adding 1 spp passes at full resolution while time remains. Each finished
+// refinement is handed to on_frame.
+//
+// The world is held by reference and is never rebuilt. Moving the camera with look() only
+// reruns camera::initialize() when the next preview starts.
+class preview_renderer {
+  public:
+    double budget_ms     = 200;  // Wall-clock budget of one preview
+    int    start_divisor = 8;    // The first frame is image_width / start_divisor wide
+
+    // Receives every refinement, upscaled to width x height, and its frame number.
+    std::function<void(const std::vector<color>& pixels, int width, int height, int frame)>
+        on_frame;
+
+    preview_renderer(camera& cam, const hittable& world) : cam(cam), world(world) {}
+
+    void look(const point3& lookfrom, const point3& lookat, double vfov) {
+        cam.lookfrom = lookfrom;
+        cam.lookat   = lookat;
+        cam.vfov     = vfov;
+    }
+
+    int render() {
+        // Produces one preview of the current view and returns the number of frames emitted.
+        using clock = std::chrono::steady_clock;
+        auto start = clock::now();
+        auto remaining = [&] {
+            std::chrono::duration<double> elapsed = clock::now() - start;
+            return budget_ms * 1e-3 - elapsed.count();
+        };
+
+        cam.initialize();
+        int full_width  = cam.image_width;
+        int full_height = cam.height();
+        int emitted     = 0;
+
+        // Coarse levels: 1 spp at increasing resolution.
+        for (int divisor = start_divisor; divisor > 1 && remaining() > 0; divisor /= 2) {
+            camera level = cam;
+            level.image_width = std::max(1, full_width / divisor);
+            level.samples_per_pixel = 1;
+
+            progressive_renderer renderer = make_renderer(remaining(), divisor);
+            if (!renderer.render(level, world))
+                break;
+            emit(renderer.fb, full_width, full_height, emitted++);
+        }
+
+        // Full resolution: one more sample per pixel per frame until the budget is spent.
+        camera full = cam;
+        full.samples_per_pixel = 0;
+        progressive_renderer renderer = make_renderer(remaining(), 1);
+        while (remaining() > 0) {
+            full.samples_per_pixel++;
+            renderer.time_budget = remaining();
+            if (!renderer.render(full, world))
+                break;
+            emit(renderer.fb, full_width, full_height, emitted++);
+        }
+
+        frames += emitted;
+        return emitted;
+    }
+
+  private:
+    camera&         cam;
+    const hittable& world;
+    int             frames = 0;  // Frames emitted by all previews so far
+
+    static progressive_renderer make_renderer(double seconds, int level_seed) {
+        progressive_renderer renderer;
+        renderer.time_budget   = seconds > 0 ? seconds : 1e-9;
+        renderer.seed          = std::uint32_t(level_seed);
+        renderer.show_progress = false;
+        return renderer;
+    }
+
+    void emit(const framebuffer& fb, int full_width, int full_height, int index) {
+        if (!on_frame)
+            return;
+
+        // Nearest-neighbour upscale, so every frame of a preview has the same size.
+        std::vector<color> pixels(size_t(full_width) * full_height);
+        for (int j = 0; j < full_height; j++) {
+            int sj = std::min(fb.height - 1, j * fb.height / full_height);
+            for (int i = 0; i < full_width; i++) {
+                int si = std::min(fb.width - 1, i * fb.width / full_width);
+                pixels[size_t(j) * full_width + i] = fb.beauty_at(fb.index(si, sj));
+            }
+        }
+        on_frame(pixels, full_width, full_height, frames + index);
+    }
+};
+
+
+#endif
@@ -0,0 +1,228 @@
+#ifndef PROGRESSIVE_H
+#define PROGRESSIVE_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include "camera.h"
+#include "framebuffer.h"
+#include "parallel.h"
+#include "tiles.h"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+// Renders the image as a series of passes that each add samples_per_pass samples to every
+// pixel of an accumulation framebuffer. Passes are split into tiles rendered in parallel.
+//
+// The generator is reseeded from (seed, pass, tile) at the start of every tile, so the
+// position (pass, next_tile) fully determines the random state and a render resumed from a
+// checkpoint produces exactly the image the uninterrupted render would have.
+class progressive_renderer {
+  public:
+    int           samples_per_pass    = 1;    // Samples added to each pixel per pass
+    int           tile_size           = 32;   // Tile edge in pixels
+    std::uint32_t seed                = 1;    // Base seed of the per-tile generators
+    double        time_budget         = 0;    // Wall-clock seconds before stopping, 0 for none
+    double        checkpoint_interval = 60;   // Seconds between checkpoints
+    std::string   checkpoint_path;            // Checkpoint file, empty to disable
+    bool          show_progress       = true; // Report passes on std::clog
+
+    traversal_order order = traversal_order::scanline;  // Tile dispatch and pixel order
+
+    framebuffer fb;         // Accumulated sums and per-pixel sample counts
+    int pass      = 0;      // Number of completed passes
+    int next_tile = 0;      // First tile of the current pass that is not rendered yet
+
+    int total_passes(const camera& cam) const {
+        return (cam.samples_per_pixel + samples_per_pass - 1) / samples_per_pass;
+    }
+
+    bool render(camera& cam, const hittable& world) {
+        // Renders until the camera's samples_per_pixel are reached or the time budget runs
+        // out, writing checkpoints along the way. Returns true if the image is complete.
+        using clock = std::chrono::steady_clock;
+
+        cam.initialize();
+        auto tiles = make_tiles(cam.image_width, cam.height(), tile_size, order);
+        if (fb.width != cam.image_width || fb.height != cam.height()) {
+            fb.resize(cam.image_width, cam.height());
+            pass = next_tile = 0;
+        }
+
+        auto start = clock::now();
+        auto deadline = start + std::chrono::duration_cast<clock::duration>(
+            std::chrono::duration<double>(time_budget > 0 ? time_budget : 1e9));
+        auto interval_length = std::chrono::duration_cast<clock::duration>(
+            std::chrono::duration<double>(checkpoint_interval));
+        auto next_checkpoint = start + interval_length;
+
+        int passes = total_passes(cam);
+        while (pass < passes) {
+            if (show_progress)
+                std::clog << "\rPass " << (pass + 1) << '/' << passes << "   " << std::flush;
+
+            // Render tiles until the pass ends or a checkpoint or the deadline comes up.
+            auto stop_at = deadline;
+            if (!checkpoint_path.empty())
+                stop_at = std::min(deadline, next_checkpoint);
+
+            int first = next_tile;
+            next_tile += parallel_for_while(
+                int(tiles.size()) - first,
+                [&] { return clock::now() < stop_at; },
+                [&](int t) { render_tile(cam, world, tiles[first + t], first + t); });
+
+            if (next_tile == int(tiles.size())) {
+                pass++;
+                next_tile = 0;
+            }
+
+            auto now = clock::now();
+            if (!checkpoint_path.empty() && (now >= next_checkpoint || now >= deadline)) {
+                if (!save_checkpoint())
+                    std::clog << "\nCould not write checkpoint " << checkpoint_path << '\n';
+                next_checkpoint = now + interval_length;
+            }
+            if (now >= deadline)
+                break;
+        }
+
+        bool complete = pass >= passes;
+        if (complete && !checkpoint_path.empty() && !save_checkpoint())
+            std::clog << "\nCould not write checkpoint " << checkpoint_path << '\n';
+
+        if (show_progress)
+            std::clog << (complete ? "\rDone.                 \n" : "\rTime budget reached.   \n");
+        return complete;
+    }
+
+    bool save_checkpoint() const {
+        // Written to a temporary file that replaces the checkpoint only once it is complete, so
+        // a crash or a failed write (disk full, no permission) keeps the previous checkpoint.
+        // Returns false if the checkpoint could not be written.
+        auto tmp_path = checkpoint_path + ".tmp";
+        bool written;
+        {
+            std::ofstream out(tmp_path, std::ios::binary);
+            write_value(out, checkpoint_magic);
+            write_value(out, fb.width);
+            write_value(out, fb.height);
+            write_value(out, tile_size);
+            write_value(out, samples_per_pass);
+            write_value(out, order);
+            write_value(out, seed);
+            write_value(out, pass);
+            write_value(out, next_tile);
+            write_vector(out, fb.beauty);
+            write_vector(out, fb.albedo);
+            write_vector(out, fb.normal);
+            write_vector(out, fb.depth);
+            write_vector(out, fb.samples);
+            out.close();
+            written = !out.fail();
+        }
+
+        std::error_code error;
+        if (written)
+            std::filesystem::rename(tmp_path, checkpoint_path, error);
+        if (!written || error) {
+            std::filesystem::remove(tmp_path, error);
+            return false;
+        }
+        return true;
+    }
+
+    bool load_checkpoint(camera& cam) {
+        // Restores a checkpoint written for the same image size, pass layout and tile order.
+        // Returns false, leaving the renderer untouched, if there is none or it does not match.
+        std::ifstream in(checkpoint_path, std::ios::binary);
+        if (!in)
+            return false;
+
+        std::uint32_t magic;
+        int width, height, tiles, spp, saved_pass, saved_tile;
+        traversal_order saved_order;
+        std::uint32_t saved_seed;
+        read_value(in, magic);
+        read_value(in, width);
+        read_value(in, height);
+        read_value(in, tiles);
+        read_value(in, spp);
+        read_value(in, saved_order);
+        read_value(in, saved_seed);
+        read_value(in, saved_pass);
+        read_value(in, saved_tile);
+
+        cam.initialize();
+        if (!in || magic != checkpoint_magic || width != cam.image_width
+            || height != cam.height() || tiles != tile_size || spp != samples_per_pass
+            || saved_order != order)
+            return false;
+
+        // A corrupt position would index past the tile list or skip the whole render.
+        int tile_count = int(make_tiles(width, height, tile_size, order).size());
+        if (saved_pass < 0 || saved_pass > total_passes(cam) || saved_tile < 0
+            || saved_tile >= tile_count)
+            return false;
+
+        framebuffer loaded;
+        loaded.resize(width, height);
+        read_vector(in, loaded.beauty);
+        read_vector(in, loaded.albedo);
+        read_vector(in, loaded.normal);
+        read_vector(in, loaded.depth);
+        read_vector(in, loaded.samples);
+        if (!in)
+            return false;
+
+        fb        = std::move(loaded);
+        seed      = saved_seed;
+        pass      = saved_pass;
+        next_tile = saved_tile;
+        return true;
+    }
+
+  private:
+    static constexpr std::uint32_t checkpoint_magic = 0x4b435450;  // "PTCK"
+
+    void render_tile(const camera& cam, const hittable& world, const tile& t, int index) {
+        seed_random({seed, std::uint32_t(pass), std::uint32_t(index)});
+        for (auto [i, j] : tile_pixel_order(t, order))
+            for (int s = 0; s < samples_per_pass; s++)
+                cam.add_sample(t.x0 + i, t.y0 + j, world, fb);
+    }
+
+    template <typename T>
+    static void write_value(std::ostream& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    static void write_vector(std::ostream& out, const std::vector<T>& values) {
+        out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    template <typename T>
+    static void read_value(std::istream& in, T& value) {
+        in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    static void read_vector(std::istream& in, std::vector<T>& values) {
+        in.read(reinterpret_cast<char*>(values.data()), values.size() * sizeof(T));
+    }
+};
+
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef SCENES_H
+#define SCENES_H
+
+#include "rtweekend.h"
+
+#include "camera.h"
+#include "hittable.h"
+#include "hittable_list.h"
+#include "material.h"
+#include "sphere.h"
+#include "box.h"
+
+
+// Escena de main.cc: suelo amarillo y un cubo azul, con su cmara
+inline void cube_scene(hittable_list& world, camera& cam) {
+    // Material para el suelo (gris claro)
+    auto material_ground = make_shared<lambertian>(color(0.8, 0.8, 0.0));
+
+    // Material para el cubo (azulado, como la esfera original de la Imagen 10)
+    auto material_cube = make_shared<lambertian>(color(0.1, 0.2, 0.5));
+
+    // Aadir suelo (una esfera grande)
+    world.add(make_shared<sphere>(point3(0, -100.5, -1.0), 100.0, material_ground));
+
+    // Aadir cubo en lugar de la esfera
+    world.add(make_shared<box>(
+        point3(-0.5, -0.5, -1.7),  // Esquina mnima
+        point3(0.5, 0.5, -0.7),    // Esquina mxima
+        material_cube
+    ));
+
+    // Configuracin de la cmara para una vista simple
+    cam.aspect_ratio = 16.0 / 9.0;
+    cam.image_width = 400;        // Resolucin menor para renderizado ms rpido
+    cam.samples_per_pixel = 100;  // Ms samples para mejor calidad
+    cam.max_depth = 50;
+    cam.vfov = 20;
+    cam.lookfrom = point3(0, 0, 1);  // Ms cerca para ver bien el cubo
+    cam.lookat = point3(0, 0, -1);
+    cam.vup = vec3(0, 1, 0);
+    cam.defocus_angle = 0;  // Sin desenfoque
+    cam.focus_dist = 10.0;
+}
+
+// Escena con cubos difusos, de metal y de vidrio, para que los rebotes mezclen materiales
+inline void mixed_cubes_scene(hittable_list& world, camera& cam) {
+    auto material_ground = make_shared<lambertian>(color(0.8, 0.8, 0.0));
+    world.add(make_shared<sphere>(point3(0, -100.5, -1.0), 100.0, material_ground));
+
+    world.add(make_shared<box>(point3(-1.7, -0.5, -1.7), point3(-0.7, 0.5, -0.7),
+                               make_shared<lambertian>(color(0.1, 0.2, 0.5))));
+    world.add(make_shared<box>(point3(-0.5, -0.5, -1.7), point3(0.5, 0.5, -0.7),
+                               make_shared<dielectric>(1.5)));
+    world.add(make_shared<box>(point3(0.7, -0.5, -1.7), point3(1.7, 0.5, -0.7),
+                               make_shared<metal>(color(0.7, 0.6, 0.5), 0.0)));
+
+    cam.aspect_ratio = 16.0 / 9.0;
+    cam.image_width = 400;
+    cam.samples_per_pixel = 100;
+    cam.max_depth = 50;
+    cam.vfov = 40;
+    cam.lookfrom = point3(1, 1.5, 3);
+    cam.lookat = point3(0, 0, -1.2);
+    cam.vup = vec3(0, 1, 0);
+    cam.defocus_angle = 0;
+    cam.focus_dist = 10.0;
+}
+
+
+#endif
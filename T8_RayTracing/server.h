@@ -0,0 +1,273 @@
+#ifndef SERVER_H
+#define SERVER_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include "camera.h"
+#include "framebuffer.h"
+#include "hittable_list.h"
+#include "net.h"
+#include "parallel.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+
+
+// Long-running render service. Scenes are built by their registered builder on first use and
+// kept resident in an LRU cache, so repeated requests skip scene construction. A request is a
+// single text line:
+//
+//   render <scene> [width=<px>] [spp=<n>] [depth=<n>] [from=x,y,z] [at=x,y,z] [vfov=<deg>]
+//          [seed=<n>]
+//   scenes
+//   quit
+//
+// Replies are "ok <bytes>\n" followed by that many bytes of payload (a P3 image for render,
+// one line per scene for scenes), or "error <message>\n". The options of render override the
+// scene's own camera, up to the max_* limits so one request cannot hold the pool for hours.
+// Renders from concurrent connections share one thread pool.
+class render_server {
+  public:
+    using scene_builder = std::function<void(hittable_list&, camera&)>;
+
+    size_t cache_capacity = 4;     // Scenes kept resident
+    bool   log_requests   = true;
+    int    max_width      = 4096;  // Largest width, spp and depth a request may ask for
+    int    max_spp        = 1024;
+    int    max_depth      = 64;
+    size_t max_line       = 4096;  // Longest request line; longer ones close the connection
+
+    explicit render_server(int threads = thread_count()) : pool(threads) {}
+
+    void add_scene(const std::string& name, scene_builder build) {
+        std::lock_guard<std::mutex> lock(mutex);
+        builders[name] = std::move(build);
+    }
+
+    std::string handle(const std::string& request) {
+        // Reply to one request line, including the "ok"/"error" header.
+        std::istringstream words(request);
+        std::string command;
+        words >> command;
+
+        if (command == "scenes")
+            return ok(list_scenes());
+        if (command != "render")
+            return "error unknown command '" + command + "'\n";
+
+        std::string name;
+        words >> name;
+        options opt;
+        std::string word;
+        while (words >> word)
+            if (!parse_option(word, opt))
+                return "error bad option '" + word + "'\n";
+
+        using clock = std::chrono::steady_clock;
+        auto start = clock::now();
+        bool cached;
+        auto resident = find_scene(name, cached);
+        if (!resident)
+            return "error unknown scene '" + name + "'\n";
+
+        auto image = render(*resident, opt);
+        if (log_requests) {
+            std::chrono::duration<double, std::milli> elapsed = clock::now() - start;
+            std::clog << "render " << name << (cached ? " (resident) " : " (built) ")
+                      << elapsed.count() << " ms\n";
+        }
+        return ok(image);
+    }
+
+    void serve(std::istream& in, std::ostream& out) {
+        // Answers requests read from in until quit or end of input.
+        std::string line;
+        while (std::getline(in, line) && line != "quit")
+            if (!line.empty())
+                out << handle(line) << std::flush;
+    }
+
+    void serve(socket_t listener) {
+        // Accepts connections forever, one thread per connection.
+        for (;;) {
+            socket_t s = accept(listener, nullptr, nullptr);
+            if (s == invalid_socket)
+                continue;
+            std::thread([this, s] { serve_connection(s); }).detach();
+        }
+    }
+
+  private:
+    struct resident_scene {
+        hittable_list world;
+        camera        cam;
+    };
+
+    struct options {
+        int           width = 0, spp = 0, depth = 0;  // 0 keeps the scene's value
+        double        vfov = 0;
+        bool          has_from = false, has_at = false;
+        point3        from, at;
+        std::uint32_t seed = 1;
+    };
+
+    thread_pool pool;
+    std::mutex  mutex;  // Guards builders and resident
+    std::map<std::string, scene_builder> builders;
+    std::list<std::pair<std::string, std::shared_ptr<const resident_scene>>> resident;  // MRU first
+
+    static std::string ok(const std::string& payload) {
+        return "ok " + std::to_string(payload.size()) + '\n' + payload;
+    }
+
+    std::string list_scenes() {
+        // Registered scenes, resident ones marked with '*'.
+        std::lock_guard<std::mutex> lock(mutex);
+        std::string names;
+        for (const auto& [name, build] : builders) {
+            bool loaded = false;
+            for (const auto& entry : resident)
+                loaded = loaded || entry.first == name;
+            names += name + (loaded ? " *\n" : "\n");
+        }
+        return names;
+    }
+
+    bool parse_option(const std::string& word, options& opt) const {
+        auto eq = word.find('=');
+        if (eq == std::string::npos)
+            return false;
+        auto key = word.substr(0, eq);
+        auto value = word.substr(eq + 1);
+        for (auto& c : value)
+            if (c == ',')
+                c = ' ';
+
+        std::istringstream in(value);
+        if (key == "width")       in >> opt.width;
+        else if (key == "spp")    in >> opt.spp;
+        else if (key == "depth")  in >> opt.depth;
+        else if (key == "vfov")   in >> opt.vfov;
+        else if (key == "seed")   in >> opt.seed;
+        else if (key == "from")   { in >> opt.from[0] >> opt.from[1] >> opt.from[2]; opt.has_from = true; }
+        else if (key == "at")     { in >> opt.at[0] >> opt.at[1] >> opt.at[2]; opt.has_at = true; }
+        else
+            return false;
+
+        return !in.fail() && opt.width >= 0 && opt.width <= max_width && opt.spp >= 0
+            && opt.spp <= max_spp && opt.depth >= 0 && opt.depth <= max_depth && opt.vfov >= 0
+            && opt.vfov < 180;
+    }
+
+    std::shared_ptr<const resident_scene> find_scene(const std::string& name, bool& cached) {
+        // The resident scene, building it (outside the lock) if it is not in the cache.
+        scene_builder build;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto it = resident.begin(); it != resident.end(); ++it) {
+                if (it->first == name) {
+                    resident.splice(resident.begin(), resident, it);
+                    cached = true;
+                    return it->second;
+                }
+            }
+            auto found = builders.find(name);
+            if (found == builders.end())
+                return nullptr;
+            build = found->second;
+        }
+
+        cached = false;
+        auto scene = std::make_shared<resident_scene>();
+        build(scene->world, scene->cam);
+
+        // Evicted scenes stay alive until the renders still using them finish. If a concurrent
+        // request built the same scene meanwhile, keep its copy so it uses only one LRU slot.
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = resident.begin(); it != resident.end(); ++it) {
+            if (it->first == name) {
+                resident.splice(resident.begin(), resident, it);
+                return it->second;
+            }
+        }
+        resident.emplace_front(name, scene);
+        while (resident.size() > cache_capacity)
+            resident.pop_back();
+        return scene;
+    }
+
+    std::string render(const resident_scene& scene, const options& opt) {
+        camera cam = scene.cam;
+        if (opt.width > 0)  cam.image_width       = opt.width;
+        if (opt.spp > 0)    cam.samples_per_pixel = opt.spp;
+        if (opt.depth > 0)  cam.max_depth         = opt.depth;
+        if (opt.vfov > 0)   cam.vfov              = opt.vfov;
+        if (opt.has_from)   cam.lookfrom          = opt.from;
+        if (opt.has_at)     cam.lookat            = opt.at;
+
+        cam.initialize();
+        framebuffer fb;
+        fb.resize(cam.image_width, cam.height());
+
+        // Rows are independent; reseeding per row keeps the image independent of scheduling.
+        pool.parallel_for(cam.height(), [&](int j) {
+            seed_random({opt.seed, std::uint32_t(j)});
+            for (int i = 0; i < cam.image_width; i++)
+                for (int s = 0; s < cam.samples_per_pixel; s++)
+                    cam.add_sample(i, j, scene.world, fb);
+        });
+
+        std::ostringstream image;
+        fb.write_ppm(image, fb.resolve());
+        return image.str();
+    }
+
+    void serve_connection(socket_t s) {
+        std::string pending;
+        char chunk[4096];
+        for (;;) {
+            auto eol = pending.find('\n');
+            if (eol == std::string::npos) {
+                if (pending.size() > max_line)
+                    break;
+                auto got = recv(s, chunk, int(sizeof(chunk)), 0);
+                if (got <= 0)
+                    break;
+                pending.append(chunk, size_t(got));
+                continue;
+            }
+
+            auto line = pending.substr(0, eol);
+            pending.erase(0, eol + 1);
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (line == "quit")
+                break;
+            if (line.empty())
+                continue;
+
+            auto reply = handle(line);
+            if (!send_all(s, reply.data(), reply.size()))
+                break;
+        }
+        close_socket(s);
+    }
+};
+
+
+#endif
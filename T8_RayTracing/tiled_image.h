@@ -0,0 +1,184 @@
+#ifndef TILED_IMAGE_H
+#define TILED_IMAGE_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include "camera.h"
+#include "parallel.h"
+#include "tiles.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+// Chunked float image on disk, for images too large to hold in memory. After a small header,
+// tile (tx, ty) is stored at a fixed offset as tile_size x tile_size RGB floats, row-major;
+// tiles on the right and bottom edges are padded to full size. Tiles can therefore be written
+// in any order and any pixel can be found with one seek.
+struct tiled_image_header {
+    std::uint32_t magic = 0x49545452;  // "RTTI"
+    std::int32_t  width = 0, height = 0;
+    std::int32_t  tile_size = 0;
+    std::int32_t  samples_per_pixel = 0;
+
+    int columns() const { return (width + tile_size - 1) / tile_size; }
+    int rows()    const { return (height + tile_size - 1) / tile_size; }
+
+    std::uint64_t tile_floats() const { return std::uint64_t(tile_size) * tile_size * 3; }
+
+    std::uint64_t offset(int tx, int ty, int row = 0) const {
+        // Byte offset of the given row of tile (tx, ty).
+        std::uint64_t index = std::uint64_t(ty) * columns() + tx;
+        return sizeof(tiled_image_header)
+             + (index * tile_floats() + std::uint64_t(row) * tile_size * 3) * sizeof(float);
+    }
+};
+
+
+class tiled_image_writer {
+  public:
+    tiled_image_header header;
+
+    bool open(const std::string& path, int width, int height, int tile_size, int spp) {
+        header.width = width;
+        header.height = height;
+        header.tile_size = tile_size;
+        header.samples_per_pixel = spp;
+
+        out.open(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        return bool(out);
+    }
+
+    void write_tile(int tx, int ty, const std::vector<float>& pixels) {
+        // pixels holds header.tile_floats() values. Safe to call from several threads.
+        std::lock_guard<std::mutex> lock(mutex);
+        out.seekp(std::streamoff(header.offset(tx, ty)));
+        out.write(reinterpret_cast<const char*>(pixels.data()),
+                  std::streamsize(pixels.size() * sizeof(float)));
+    }
+
+    bool close() {
+        out.close();
+        return !out.fail();
+    }
+
+  private:
+    std::ofstream out;
+    std::mutex    mutex;
+};
+
+
+class tiled_image_reader {
+  public:
+    tiled_image_header header;
+
+    bool open(const std::string& path) {
+        in.open(path, std::ios::binary);
+        in.read(reinterpret_cast<char*>(&header), sizeof(header));
+        return in && header.magic == tiled_image_header().magic && header.tile_size > 0;
+    }
+
+    bool read_scanline(int j, std::vector<float>& line) {
+        // Row j of the whole image, 3 * width floats, gathered from one tile row.
+        int ty = j / header.tile_size, row = j % header.tile_size;
+        line.resize(size_t(header.width) * 3);
+        for (int tx = 0; tx < header.columns(); tx++) {
+            int x0 = tx * header.tile_size;
+            int count = std::min(header.tile_size, header.width - x0);
+            in.seekg(std::streamoff(header.offset(tx, ty, row)));
+            in.read(reinterpret_cast<char*>(line.data() + size_t(x0) * 3),
+                    std::streamsize(count * 3 * sizeof(float)));
+        }
+        return bool(in);
+    }
+
+  private:
+    std::ifstream in;
+};
+
+
+inline bool render_tiled(camera& cam, const hittable& world, const std::string& path,
+                         int tile_size = 64, std::uint32_t seed = 1) {
+    // Renders straight into a tiled image file. Each thread holds only the tile it is
+    // rendering, so memory stays at thread_count() tiles whatever the image size.
+    cam.initialize();
+    tiled_image_writer writer;
+    if (!writer.open(path, cam.image_width, cam.height(), tile_size, cam.samples_per_pixel))
+        return false;
+
+    auto tiles = make_tiles(cam.image_width, cam.height(), tile_size);
+    double scale = 1.0 / cam.samples_per_pixel;
+
+    parallel_for(int(tiles.size()), [&](int t) {
+        const auto& tl = tiles[t];
+        seed_random({seed, std::uint32_t(t)});
+        std::vector<float> pixels(writer.header.tile_floats(), 0.0f);
+
+        for (int j = tl.y0; j < tl.y1; j++) {
+            for (int i = tl.x0; i < tl.x1; i++) {
+                color pixel_color(0,0,0);
+                for (int s = 0; s < cam.samples_per_pixel; s++)
+                    pixel_color += cam.ray_color(cam.get_ray(i, j), cam.max_depth, world);
+                auto p = (size_t(j - tl.y0) * tile_size + (i - tl.x0)) * 3;
+                pixels[p + 0] = float(scale * pixel_color.x());
+                pixels[p + 1] = float(scale * pixel_color.y());
+                pixels[p + 2] = float(scale * pixel_color.z());
+            }
+        }
+
+        writer.write_tile(tl.x0 / tile_size, tl.y0 / tile_size, pixels);
+        if (t % 64 == 0)
+            std::clog << "\rTiles remaining: " << (tiles.size() - t) << "   " << std::flush;
+    });
+
+    std::clog << "\rDone.                 \n";
+    return writer.close();
+}
+
+
+inline bool write_tiled_ppm(const std::string& path, std::ostream& out, int factor = 1) {
+    // Writes the image as PPM, box-filtered down by factor in both directions. Reads one
+    // scanline at a time, so memory is a few rows of the image, never the whole of it.
+    tiled_image_reader reader;
+    if (!reader.open(path) || factor < 1)
+        return false;
+
+    int width  = reader.header.width / factor;
+    int height = reader.header.height / factor;
+    out << "P3\n" << width << ' ' << height << "\n255\n";
+
+    std::vector<float> line;
+    std::vector<double> sums(size_t(width) * 3);
+    double scale = 1.0 / (double(factor) * factor);
+
+    for (int j = 0; j < height; j++) {
+        std::fill(sums.begin(), sums.end(), 0.0);
+        for (int row = 0; row < factor; row++) {
+            if (!reader.read_scanline(j * factor + row, line))
+                return false;
+            for (int i = 0; i < width * factor; i++)
+                for (int c = 0; c < 3; c++)
+                    sums[size_t(i / factor) * 3 + c] += line[size_t(i) * 3 + c];
+        }
+
+        for (int i = 0; i < width; i++) {
+            auto s = &sums[size_t(i) * 3];
+            write_color(out, scale * color(s[0], s[1], s[2]));
+        }
+    }
+    return bool(out);
+}
+
+
+#endif
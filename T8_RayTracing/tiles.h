@@ -0,0 +1,131 @@
+#ifndef TILES_H
+#define TILES_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+
+// Rectangle of pixels [x0, x1) x [y0, y1); the unit of work of the tiled renderers.
+struct tile {
+    int x0, y0, x1, y1;
+};
+
+
+// Order in which tiles are dispatched and pixels inside a tile are visited. The space-filling
+// curves keep consecutive pixels (and so consecutive rays) close together in both directions,
+// where scanline order jumps a whole row back after every tile or image width.
+enum class traversal_order { scanline, morton, hilbert };
+
+inline traversal_order traversal_order_from_name(const std::string& name) {
+    if (name == "morton")  return traversal_order::morton;
+    if (name == "hilbert") return traversal_order::hilbert;
+    return traversal_order::scanline;
+}
+
+inline const char* traversal_order_name(traversal_order order) {
+    switch (order) {
+        case traversal_order::morton:  return "morton";
+        case traversal_order::hilbert: return "hilbert";
+        default:                       return "scanline";
+    }
+}
+
+inline std::uint64_t curve_index(traversal_order order, std::uint32_t x, std::uint32_t y,
+                                 std::uint32_t n) {
+    // Position of (x, y) along the curve covering an n x n grid, n a power of two.
+    if (order == traversal_order::morton) {
+        std::uint64_t d = 0;
+        for (int bit = 0; bit < 32; bit++) {
+            d |= std::uint64_t((x >> bit) & 1) << (2*bit);
+            d |= std::uint64_t((y >> bit) & 1) << (2*bit + 1);
+        }
+        return d;
+    }
+
+    if (order == traversal_order::hilbert) {
+        std::uint64_t d = 0;
+        for (std::uint32_t s = n/2; s > 0; s /= 2) {
+            std::uint32_t rx = (x & s) > 0;
+            std::uint32_t ry = (y & s) > 0;
+            d += std::uint64_t(s) * s * ((3 * rx) ^ ry);
+
+            // Rotate the quadrant so the sub-curve starts and ends at the right corners.
+            if (ry == 0) {
+                if (rx == 1) {
+                    x = n-1 - x;
+                    y = n-1 - y;
+                }
+                std::swap(x, y);
+            }
+        }
+        return d;
+    }
+
+    return std::uint64_t(y) * n + x;
+}
+
+inline std::vector<std::pair<int,int>> curve_order(int width, int height, traversal_order order) {
+    // All cells of a width x height grid, sorted along the curve.
+    std::uint32_t n = 1;
+    while (n < std::uint32_t(std::max(width, height)))
+        n *= 2;
+
+    std::vector<std::pair<std::uint64_t, std::pair<int,int>>> keyed;
+    keyed.reserve(size_t(width) * height);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            keyed.push_back({curve_index(order, x, y, n), {x, y}});
+    std::sort(keyed.begin(), keyed.end());
+
+    std::vector<std::pair<int,int>> cells;
+    cells.reserve(keyed.size());
+    for (const auto& k : keyed)
+        cells.push_back(k.second);
+    return cells;
+}
+
+
+inline std::vector<tile> make_tiles(int width, int height, int size,
+                                    traversal_order order = traversal_order::scanline) {
+    // Splits the image into size x size tiles, clipped at the right and bottom edges, listed
+    // in the given dispatch order.
+    int columns = (width + size - 1) / size;
+    int rows    = (height + size - 1) / size;
+
+    std::vector<tile> tiles;
+    for (auto [tx, ty] : curve_order(columns, rows, order)) {
+        int x = tx * size, y = ty * size;
+        tiles.push_back({x, y, std::min(x + size, width), std::min(y + size, height)});
+    }
+    return tiles;
+}
+
+inline const std::vector<std::pair<int,int>>& tile_pixel_order(const tile& t, traversal_order order) {
+    // Pixel offsets inside a tile, relative to (x0, y0), in visiting order. Sorting along the
+    // curve is computed once per tile size and order; only the clipped edge tiles add sizes.
+    // The cache is per thread so the parallel tile loops need no locking.
+    thread_local std::map<std::tuple<int,int,traversal_order>, std::vector<std::pair<int,int>>> cache;
+
+    int width = t.x1 - t.x0, height = t.y1 - t.y0;
+    auto key = std::make_tuple(width, height, order);
+    auto found = cache.find(key);
+    if (found == cache.end())
+        found = cache.emplace(key, curve_order(width, height, order)).first;
+    return found->second;
+}
+
+
+#endif
@@ -0,0 +1,282 @@
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include "camera.h"
+#include "framebuffer.h"
+#include "net.h"
+#include "tiles.h"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Multi-process rendering over TCP. A coordinator splits the image into jobs (a tile and a
+// range of its samples) and hands them to worker processes, one job in flight per worker.
+// Workers build the scene once, render each job into float radiance sums and send them back;
+// the coordinator adds them to its framebuffer.
+//
+// The generator is reseeded from (seed, sample_start, tile) for every job, so a job gives the
+// same sums on any worker. When a worker disconnects its unfinished job goes back in the
+// queue, and the final image does not depend on which worker rendered what.
+//
+// Messages are fixed-size structs in host byte order: all processes must share an endianness.
+
+struct render_hello {
+    std::uint32_t magic;
+    std::int32_t  width, height;  // Image size of the worker's camera, checked by the coordinator
+};
+
+struct render_job {
+    std::int32_t  id;               // Index in the coordinator's job list, -1 to stop the worker
+    std::int32_t  x0, y0, x1, y1;   // Tile rectangle
+    std::int32_t  tile_index;
+    std::int32_t  sample_start;     // First sample of the range
+    std::int32_t  sample_count;
+    std::uint32_t seed;
+};
+
+struct job_result {
+    std::int32_t id;
+    std::int32_t pixel_count;       // Followed by 3 * pixel_count floats, row-major in the tile
+};
+
+const std::uint32_t render_protocol_magic = 0x4b524452;  // "RDRK"
+
+
+inline void render_job_sums(const camera& cam, const hittable& world, const render_job& job,
+                            std::vector<float>& sums) {
+    // Radiance sums of the job's samples for every pixel of its tile. cam must be initialized.
+    seed_random({job.seed, std::uint32_t(job.sample_start), std::uint32_t(job.tile_index)});
+
+    sums.clear();
+    for (int j = job.y0; j < job.y1; j++) {
+        for (int i = job.x0; i < job.x1; i++) {
+            color pixel_color(0,0,0);
+            for (int s = 0; s < job.sample_count; s++)
+                pixel_color += cam.ray_color(cam.get_ray(i, j), cam.max_depth, world);
+            sums.push_back(float(pixel_color.x()));
+            sums.push_back(float(pixel_color.y()));
+            sums.push_back(float(pixel_color.z()));
+        }
+    }
+}
+
+
+inline int run_render_worker(camera& cam, const hittable& world, const std::string& host,
+                             int port, int max_jobs = -1) {
+    // Serves jobs until the coordinator stops it or goes away; returns the number of jobs
+    // completed, or -1 if no coordinator could be reached. With max_jobs >= 0 the worker drops
+    // the connection on receiving job max_jobs + 1, as if it crashed in the middle of it.
+    cam.initialize();
+
+    // The coordinator may still be starting up: retry for a few seconds.
+    socket_t s = invalid_socket;
+    for (int attempt = 0; attempt < 50 && s == invalid_socket; attempt++) {
+        s = connect_tcp(host, port);
+        if (s == invalid_socket)
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+    if (s == invalid_socket)
+        return -1;
+
+    render_hello hello{render_protocol_magic, cam.image_width, cam.height()};
+    int completed = 0;
+    std::vector<float> sums;
+
+    if (send_all(s, &hello, sizeof(hello))) {
+        render_job job;
+        while (recv_all(s, &job, sizeof(job)) && job.id >= 0) {
+            if (max_jobs >= 0 && completed == max_jobs)
+                break;
+
+            render_job_sums(cam, world, job, sums);
+            job_result result{job.id, std::int32_t(sums.size() / 3)};
+            if (!send_all(s, &result, sizeof(result))
+                || !send_all(s, sums.data(), sums.size() * sizeof(float)))
+                break;
+            completed++;
+        }
+    }
+
+    close_socket(s);
+    return completed;
+}
+
+
+class render_coordinator {
+  public:
+    int           tile_size       = 32;    // Tile edge in pixels
+    int           samples_per_job = 0;     // Samples of a tile per job, 0 for all of them
+    std::uint32_t seed            = 1;     // Base seed of the per-job generators
+    bool          show_progress   = true;  // Report finished jobs and workers on std::clog
+    int           receive_timeout = 5000;  // Milliseconds a worker may stall mid-message before
+                                           // it is dropped (and its job requeued)
+
+    traversal_order order = traversal_order::scanline;  // Tile dispatch order
+
+    framebuffer fb;  // Accumulated sums and per-pixel sample counts
+
+    void render(camera& cam, socket_t listener) {
+        // Accepts workers on listener and returns once every job is merged into fb. Workers
+        // may join at any time; if all of them are gone, it waits for new ones.
+        cam.initialize();
+        fb.resize(cam.image_width, cam.height());
+        make_jobs(cam);
+
+        std::deque<int> pending;
+        for (int id = 0; id < int(jobs.size()); id++)
+            pending.push_back(id);
+
+        std::vector<worker_connection> workers;
+        std::vector<pollfd> fds;
+        std::vector<float> sums;
+        int remaining = int(jobs.size());
+
+        auto drop = [&](size_t w) {
+            // Puts the worker's job, if any, back at the front of the queue.
+            if (workers[w].job >= 0)
+                pending.push_front(workers[w].job);
+            close_socket(workers[w].s);
+            workers.erase(workers.begin() + w);
+            if (show_progress)
+                std::clog << "\rWorker lost, " << workers.size() << " left.           \n";
+        };
+
+        while (remaining > 0) {
+            for (size_t w = 0; w < workers.size(); ) {
+                if (workers[w].job < 0 && !pending.empty()) {
+                    workers[w].job = pending.front();
+                    pending.pop_front();
+                    if (!send_all(workers[w].s, &jobs[workers[w].job], sizeof(render_job))) {
+                        drop(w);
+                        continue;
+                    }
+                }
+                w++;
+            }
+
+            fds.assign(1, pollfd{listener, POLLIN, 0});
+            for (const auto& worker : workers)
+                fds.push_back(pollfd{worker.s, POLLIN, 0});
+            if (poll_sockets(fds.data(), fds.size(), 1000) <= 0)
+                continue;
+
+            // Results first, in reverse so dropping a worker keeps the remaining fds aligned.
+            for (size_t w = workers.size(); w-- > 0; ) {
+                if (!(fds[w + 1].revents & (POLLIN | POLLERR | POLLHUP)))
+                    continue;
+                if (!receive_result(workers[w], sums)) {
+                    drop(w);
+                    continue;
+                }
+                workers[w].job = -1;
+                remaining--;
+                if (show_progress)
+                    std::clog << "\rJobs remaining: " << remaining << ", workers: "
+                              << workers.size() << "   " << std::flush;
+            }
+
+            if (fds[0].revents & POLLIN)
+                accept_worker(listener, workers);
+        }
+
+        // Release the workers; they exit when they read the stop job.
+        render_job stop{};
+        stop.id = -1;
+        for (const auto& worker : workers) {
+            send_all(worker.s, &stop, sizeof(stop));
+            close_socket(worker.s);
+        }
+
+        if (show_progress)
+            std::clog << "\rDone.                                  \n";
+    }
+
+  private:
+    struct worker_connection {
+        socket_t s;
+        int      job;  // Job in flight, -1 if idle
+    };
+
+    std::vector<render_job> jobs;
+
+    void make_jobs(const camera& cam) {
+        int per_job = samples_per_job > 0 ? samples_per_job : cam.samples_per_pixel;
+        auto tiles = make_tiles(cam.image_width, cam.height(), tile_size, order);
+
+        // Sample ranges in the outer loop, so early results cover the whole image.
+        jobs.clear();
+        for (int start = 0; start < cam.samples_per_pixel; start += per_job) {
+            int count = std::min(per_job, cam.samples_per_pixel - start);
+            for (int t = 0; t < int(tiles.size()); t++) {
+                const auto& tl = tiles[t];
+                jobs.push_back({int(jobs.size()), tl.x0, tl.y0, tl.x1, tl.y1, t, start, count,
+                                seed});
+            }
+        }
+    }
+
+    void accept_worker(socket_t listener, std::vector<worker_connection>& workers) const {
+        socket_t s = accept(listener, nullptr, nullptr);
+        if (s == invalid_socket)
+            return;
+        set_no_delay(s);
+
+        // Reads block the whole coordinator, so a peer that connects and goes quiet, or stops
+        // halfway through a result, must not be able to hold them forever.
+        set_receive_timeout(s, receive_timeout);
+
+        // Refuse workers that built a different image.
+        render_hello hello;
+        if (!recv_all(s, &hello, sizeof(hello)) || hello.magic != render_protocol_magic
+            || hello.width != fb.width || hello.height != fb.height) {
+            close_socket(s);
+            return;
+        }
+
+        workers.push_back({s, -1});
+        if (show_progress)
+            std::clog << "\rWorker joined, " << workers.size() << " connected.      \n";
+    }
+
+    bool receive_result(const worker_connection& worker, std::vector<float>& sums) {
+        // Reads one result and adds it to fb. False if the worker is gone or misbehaves.
+        job_result result;
+        if (worker.job < 0 || !recv_all(worker.s, &result, sizeof(result)))
+            return false;
+
+        const auto& job = jobs[worker.job];
+        int pixels = (job.x1 - job.x0) * (job.y1 - job.y0);
+        if (result.id != job.id || result.pixel_count != pixels)
+            return false;
+
+        sums.resize(size_t(pixels) * 3);
+        if (!recv_all(worker.s, sums.data(), sums.size() * sizeof(float)))
+            return false;
+
+        const float* sum = sums.data();
+        for (int j = job.y0; j < job.y1; j++) {
+            for (int i = job.x0; i < job.x1; i++, sum += 3) {
+                auto p = fb.index(i, j);
+                fb.beauty[p] += color(sum[0], sum[1], sum[2]);
+                fb.samples[p] += job.sample_count;
+            }
+        }
+        return true;
+    }
+};
+
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include <vector>
+
+
+// Floating point render target. Every buffer holds per-pixel sums over the samples taken so
+// far; the accessors divide by the sample count. Besides the beauty image it keeps the
+// first-hit albedo, normal and depth (distance along the camera ray, 0 for the sky), which
+// guide the denoiser.
+class framebuffer {
+  public:
+    int width  = 0;
+    int height = 0;
+
+    std::vector<color>  beauty;   // Sum of radiance samples
+    std::vector<color>  albedo;   // Sum of first-hit albedos
+    std::vector<vec3>   normal;   // Sum of first-hit normals
+    std::vector<double> depth;    // Sum of first-hit distances
+    std::vector<int>    samples;  // Number of samples added to each pixel
+
+    void resize(int w, int h) {
+        width  = w;
+        height = h;
+
+        auto n = size_t(w) * h;
+        beauty.assign(n, color(0,0,0));
+        albedo.assign(n, color(0,0,0));
+        normal.assign(n, vec3(0,0,0));
+        depth.assign(n, 0.0);
+        samples.assign(n, 0);
+    }
+
+    size_t index(int i, int j) const { return size_t(j) * width + i; }
+
+    color  beauty_at(size_t p) const { return beauty[p] * scale(p); }
+    color  albedo_at(size_t p) const { return albedo[p] * scale(p); }
+    vec3   normal_at(size_t p) const { return normal[p] * scale(p); }
+    double depth_at(size_t p)  const { return depth[p] * scale(p); }
+
+    // Resolved beauty image, one color per pixel.
+    std::vector<color> resolve() const {
+        std::vector<color> pixels(beauty.size());
+        for (size_t p = 0; p < pixels.size(); p++)
+            pixels[p] = beauty_at(p);
+        return pixels;
+    }
+
+    void write_ppm(std::ostream& out, const std::vector<color>& pixels) const {
+        out << "P3\n" << width << ' ' << height << "\n255\n";
+        for (const auto& pixel_color : pixels)
+            write_color(out, pixel_color);
+    }
+
+  private:
+    double scale(size_t p) const { return samples[p] > 0 ? 1.0 / samples[p] : 0.0; }
+};
+
+
+#endif
@@ -21,6 +21,7 @@ class hit_record {
     shared_ptr<material> mat;
     double t;
     bool front_face;
+    int object = -1;  // Index of the hit object in the enclosing hittable_list
 
     void set_face_normal(const ray& r, const vec3& outward_normal) {
         // Sets the hit record normal vector.
@@ -34,11 +34,12 @@ class hittable_list : public hittable {
         bool hit_anything = false;
         auto closest_so_far = ray_t.max;
 
-        for (const auto& object : objects) {
-            if (object->hit(r, interval(ray_t.min, closest_so_far), temp_rec)) {
+        for (size_t i = 0; i < objects.size(); i++) {
+            if (objects[i]->hit(r, interval(ray_t.min, closest_so_far), temp_rec)) {
                 hit_anything = true;
                 closest_so_far = temp_rec.t;
                 rec = temp_rec;
+                rec.object = int(i);
             }
         }
 
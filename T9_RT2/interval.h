@@ -38,8 +38,8 @@ class interval {
     static const interval empty, universe;
 };
 
-const interval interval::empty    = interval(+infinity, -infinity);
-const interval interval::universe = interval(-infinity, +infinity);
+inline const interval interval::empty    = interval(+infinity, -infinity);
+inline const interval interval::universe = interval(-infinity, +infinity);
 
 
 #endif
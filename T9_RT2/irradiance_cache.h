@@ -0,0 +1,316 @@
+#ifndef IRRADIANCE_CACHE_H
+#define IRRADIANCE_CACHE_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include "camera.h"
+#include "framebuffer.h"
+#include "hittable.h"
+#include "material.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+
+// Irradiance caching (Ward et al. 1988) with the rotational and translational gradients of
+// Ward & Heckbert 1992. Irradiance at lambertian hits varies slowly, so it is computed with a
+// stratified hemisphere of rays at sparse points only and interpolated everywhere else.
+//
+// Records are created lazily when a lookup finds no record valid at the query point, and are
+// kept in an octree. Lookups take a shared lock and insertions an exclusive one, so any number
+// of render threads can use the cache at once.
+class irradiance_cache {
+  public:
+    double error        = 0.2;   // Ward's a: records are valid up to a times their radius
+    int    theta_strata = 8;     // Hemisphere strata in elevation (M)
+    int    phi_strata   = 32;    // Hemisphere strata in azimuth (N)
+    double min_spacing  = 0.02;  // Bounds on a record's harmonic mean distance, world units
+    double max_spacing  = 2.0;
+
+    irradiance_cache(const point3& center, double half_size)
+      : root(std::make_unique<node>(center, half_size)) {}
+
+    size_t size() const { return record_count; }
+
+    color irradiance(const point3& p, const vec3& n, const camera& cam, const hittable& world) {
+        // Irradiance arriving at p on a surface with unit normal n. Interpolated from the
+        // cache, or computed and cached if no record is valid. Records are shared by paths of
+        // any length, so they are always computed with the camera's full bounce budget.
+        color e;
+        if (lookup(p, n, e))
+            return e;
+
+        auto rec = compute(p, n, cam, world, cam.max_depth);
+        insert(rec);
+        return rec.irradiance;
+    }
+
+  private:
+    struct record {
+        point3 p;
+        vec3   n;
+        color  irradiance;
+        double radius;          // Harmonic mean distance to the surfaces seen from p
+        vec3   rotation[3];     // Per-channel gradient for rotating n
+        vec3   translation[3];  // Per-channel gradient for moving p
+    };
+
+    struct node {
+        point3 center;
+        double half_size;
+        double max_reach = 0;   // Largest validity radius of the records in this subtree
+        std::vector<record> records;
+        std::unique_ptr<node> children[8];
+
+        node(const point3& c, double h) : center(c), half_size(h) {}
+
+        double distance(const point3& p) const {
+            // Distance from p to the node's cube, 0 inside.
+            double d2 = 0;
+            for (int a = 0; a < 3; a++) {
+                double d = std::fabs(p[a] - center[a]) - half_size;
+                if (d > 0)
+                    d2 += d*d;
+            }
+            return std::sqrt(d2);
+        }
+    };
+
+    std::unique_ptr<node>     root;
+    mutable std::shared_mutex mutex;
+    std::atomic<size_t>       record_count{0};
+
+    static const int max_depth = 20;
+
+    double weight(const record& r, const point3& p, const vec3& n) const {
+        // Ward's weight, or 0 if the record is not valid at p.
+        auto d = p - r.p;
+
+        // Reject records in front of p: they see a different part of the scene.
+        if (dot(d, 0.5 * (n + r.n)) < -0.05 * r.radius)
+            return 0;
+
+        double denominator = d.length() / r.radius + std::sqrt(std::max(0.0, 1.0 - dot(n, r.n)));
+        if (denominator >= error)
+            return 0;
+        return 1 / std::max(denominator, 1e-6);
+    }
+
+    bool lookup(const point3& p, const vec3& n, color& e) const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+
+        double total = 0;
+        color sum(0,0,0);
+        gather(*root, p, n, total, sum);
+        if (total <= 0)
+            return false;
+
+        e = sum / total;
+        return true;
+    }
+
+    void gather(const node& nd, const point3& p, const vec3& n, double& total, color& sum) const {
+        if (nd.distance(p) > nd.max_reach)
+            return;
+
+        for (const auto& r : nd.records) {
+            double w = weight(r, p, n);
+            if (w <= 0)
+                continue;
+
+            // Gradient-extrapolated irradiance of the record at p.
+            auto axis = cross(r.n, n);
+            auto d = p - r.p;
+            color e = r.irradiance;
+            for (int c = 0; c < 3; c++)
+                e[c] = std::max(0.0, e[c] + dot(axis, r.rotation[c]) + dot(d, r.translation[c]));
+
+            sum += w * e;
+            total += w;
+        }
+
+        for (const auto& child : nd.children)
+            if (child)
+                gather(*child, p, n, total, sum);
+    }
+
+    void insert(const record& r) {
+        // Stores r in the smallest node at least as large as its validity radius.
+        std::unique_lock<std::shared_mutex> lock(mutex);
+
+        double reach = r.radius * error;
+        node* nd = root.get();
+        for (int level = 0; level < max_depth; level++) {
+            nd->max_reach = std::max(nd->max_reach, reach + nd->distance(r.p));
+            if (nd->half_size < 2 * reach || nd->distance(r.p) > 0)
+                break;
+
+            int octant = (r.p.x() > nd->center.x()) | (r.p.y() > nd->center.y()) << 1
+                       | (r.p.z() > nd->center.z()) << 2;
+            if (!nd->children[octant]) {
+                double h = nd->half_size / 2;
+                point3 c(nd->center.x() + (octant & 1 ? h : -h),
+                         nd->center.y() + (octant & 2 ? h : -h),
+                         nd->center.z() + (octant & 4 ? h : -h));
+                nd->children[octant] = std::make_unique<node>(c, h);
+            }
+            nd = nd->children[octant].get();
+        }
+        nd->max_reach = std::max(nd->max_reach, reach + nd->distance(r.p));
+        nd->records.push_back(r);
+        record_count++;
+    }
+
+    record compute(const point3& p, const vec3& n, const camera& cam, const hittable& world,
+                   int depth) const {
+        // Samples one ray per stratum of a cosine-weighted M x N hemisphere and derives the
+        // irradiance, its gradients and the record's radius from the radiance and hit distance
+        // of each stratum.
+        const int M = theta_strata, N = phi_strata;
+
+        // Tangent frame: u, v in the surface plane, n up.
+        vec3 a = std::fabs(n.x()) > 0.9 ? vec3(0,1,0) : vec3(1,0,0);
+        vec3 v = unit_vector(cross(n, a));
+        vec3 u = cross(v, n);
+        auto tangent = [&](double phi) { return std::cos(phi) * u + std::sin(phi) * v; };
+
+        std::vector<color>  radiance(size_t(M) * N);
+        std::vector<double> distance(size_t(M) * N);
+        double inverse_distances = 0;
+
+        for (int j = 0; j < M; j++) {
+            for (int k = 0; k < N; k++) {
+                double sin_theta = std::sqrt((j + random_double()) / M);
+                double cos_theta = std::sqrt(1 - sin_theta*sin_theta);
+                double phi = 2*pi * (k + random_double()) / N;
+                ray r(p, sin_theta * tangent(phi) + cos_theta * n);
+
+                auto& l = radiance[size_t(j) * N + k];
+                auto& dist = distance[size_t(j) * N + k];
+                hit_record rec;
+                if (depth > 1 && world.hit(r, interval(0.001, infinity), rec)) {
+                    l = cam.shade(r, rec, depth-1, world);
+                    dist = rec.t;
+                } else {
+                    l = depth > 1 ? camera::background(r) : color(0,0,0);
+                    dist = infinity;
+                }
+                inverse_distances += 1 / dist;
+            }
+        }
+
+        record rec;
+        rec.p = p;
+        rec.n = n;
+        rec.irradiance = color(0,0,0);
+        for (const auto& l : radiance)
+            rec.irradiance += l;
+        rec.irradiance *= pi / (M * N);
+
+        auto L = [&](int j, int k) { return radiance[size_t(j) * N + (k + N) % N]; };
+        auto R = [&](int j, int k) { return distance[size_t(j) * N + (k + N) % N]; };
+        auto theta_edge = [&](double j) { return std::asin(std::sqrt(j / M)); };
+
+        // Rotational gradient.
+        for (int c = 0; c < 3; c++)
+            rec.rotation[c] = vec3(0,0,0);
+        for (int k = 0; k < N; k++) {
+            vec3 vk = tangent(2*pi * (k + 0.5) / N + pi/2);
+            for (int j = 0; j < M; j++) {
+                double tan_theta = std::tan(theta_edge(j + 0.5));
+                for (int c = 0; c < 3; c++)
+                    rec.rotation[c] += (tan_theta * L(j, k)[c] * pi / (M * N)) * vk;
+            }
+        }
+
+        // Translational gradient: radiance changes across the boundaries between strata,
+        // scaled by the distance to the nearer of the two surfaces.
+        for (int c = 0; c < 3; c++)
+            rec.translation[c] = vec3(0,0,0);
+        for (int k = 0; k < N; k++) {
+            vec3 uk = tangent(2*pi * (k + 0.5) / N);
+            vec3 vk = tangent(2*pi * k / N + pi/2);
+
+            for (int j = 1; j < M; j++) {
+                double t = theta_edge(j);
+                double scale = (2*pi / N) * std::sin(t) * std::cos(t) * std::cos(t)
+                             / std::min(R(j, k), R(j-1, k));
+                for (int c = 0; c < 3; c++)
+                    rec.translation[c] += (scale * (L(j-1, k)[c] - L(j, k)[c])) * uk;
+            }
+
+            for (int j = 0; j < M; j++) {
+                double scale = (std::cos(theta_edge(j + 1)) - std::cos(theta_edge(j)))
+                             / (std::sin(theta_edge(j + 0.5)) * std::min(R(j, k), R(j, k-1)));
+                for (int c = 0; c < 3; c++)
+                    rec.translation[c] += (scale * (L(j, k-1)[c] - L(j, k)[c])) * vk;
+            }
+        }
+
+        // Radius: harmonic mean distance, clamped, and small enough that the translational
+        // gradient does not extrapolate by more than the irradiance itself.
+        rec.radius = (M * N) / std::max(inverse_distances, 1e-12);
+        double mean = (rec.irradiance.x() + rec.irradiance.y() + rec.irradiance.z()) / 3;
+        double slope = (rec.translation[0] + rec.translation[1] + rec.translation[2]).length() / 3;
+        if (slope > 0)
+            rec.radius = std::min(rec.radius, mean / slope);
+        rec.radius = std::clamp(rec.radius, min_spacing, max_spacing);
+        return rec;
+    }
+};
+
+
+inline color cached_ray_color(const camera& cam, const ray& r, int depth, const hittable& world,
+                              irradiance_cache& cache) {
+    // Like camera::ray_color, but the first lambertian surface along the path takes its
+    // incoming light from the irradiance cache instead of continuing the path.
+    if (depth <= 0)
+        return color(0,0,0);
+
+    hit_record rec;
+    if (!world.hit(r, interval(0.001, infinity), rec))
+        return camera::background(r);
+
+    if (rec.mat->kind() == material_kind::lambertian)
+        return rec.mat->aov_albedo() * cache.irradiance(rec.p, rec.normal, cam, world) / pi;
+
+    ray scattered;
+    color attenuation;
+    if (rec.mat->scatter(r, rec, attenuation, scattered))
+        return attenuation * cached_ray_color(cam, scattered, depth-1, world, cache);
+    return color(0,0,0);
+}
+
+inline void render_irradiance_cached(camera& cam, const hittable& world, irradiance_cache& cache,
+                                     framebuffer& fb, std::uint32_t seed = 1) {
+    // Renders the beauty image into fb, rows in parallel, filling the cache as it goes.
+    cam.initialize();
+    fb.resize(cam.image_width, cam.height());
+
+    parallel_for(cam.height(), [&](int j) {
+        seed_random({seed, std::uint32_t(j)});
+        for (int i = 0; i < cam.image_width; i++) {
+            auto p = fb.index(i, j);
+            for (int s = 0; s < cam.samples_per_pixel; s++) {
+                fb.beauty[p] += cached_ray_color(cam, cam.get_ray(i, j), cam.max_depth, world, cache);
+                fb.samples[p]++;
+            }
+        }
+    });
+}
+
+
+#endif
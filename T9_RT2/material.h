@@ -14,10 +14,19 @@
 #include "hittable.h"
 
 
+// Material families, used by the wavefront integrator to sort hits before scattering.
+enum class material_kind { other, lambertian, metal, dielectric };
+
+
 class material {
   public:
     virtual ~material() = default;
 
+    virtual material_kind kind() const { return material_kind::other; }
+
+    // Surface color written to the albedo AOV; guides the denoiser.
+    virtual color aov_albedo() const { return color(1,1,1); }
+
     virtual bool scatter(
         const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered
     ) const {
@@ -30,6 +39,10 @@ class lambertian : public material {
   public:
     lambertian(const color& albedo) : albedo(albedo) {}
 
+    material_kind kind() const override { return material_kind::lambertian; }
+
+    color aov_albedo() const override { return albedo; }
+
     bool scatter(const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered)
     const override {
         auto scatter_direction = rec.normal + random_unit_vector();
@@ -52,6 +65,10 @@ class metal : public material {
   public:
     metal(const color& albedo, double fuzz) : albedo(albedo), fuzz(fuzz < 1 ? fuzz : 1) {}
 
+    material_kind kind() const override { return material_kind::metal; }
+
+    color aov_albedo() const override { return albedo; }
+
     bool scatter(const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered)
     const override {
         vec3 reflected = reflect(r_in.direction(), rec.normal);
@@ -71,6 +88,8 @@ class dielectric : public material {
   public:
     dielectric(double refraction_index) : refraction_index(refraction_index) {}
 
+    material_kind kind() const override { return material_kind::dielectric; }
+
     bool scatter(const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered)
     const override {
         attenuation = color(1.0, 1.0, 1.0);
@@ -0,0 +1,158 @@
+#ifndef NET_H
+#define NET_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+// Minimal blocking TCP helpers over BSD sockets / Winsock, enough for the distributed and
+// server render modes.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+
+using socket_t = SOCKET;
+const socket_t invalid_socket = INVALID_SOCKET;
+
+inline void close_socket(socket_t s) { closesocket(s); }
+
+inline int poll_sockets(pollfd* fds, size_t count, int timeout_ms) {
+    return WSAPoll(fds, ULONG(count), timeout_ms);
+}
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using socket_t = int;
+const socket_t invalid_socket = -1;
+
+inline void close_socket(socket_t s) { close(s); }
+
+inline int poll_sockets(pollfd* fds, size_t count, int timeout_ms) {
+    return poll(fds, nfds_t(count), timeout_ms);
+}
+#endif
+
+
+inline bool net_startup() {
+    // Must be called once before any other function here.
+#ifdef _WIN32
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+    return true;
+#endif
+}
+
+inline void set_no_delay(socket_t s) {
+    // Jobs and results are small request/response messages; don't let Nagle hold them back.
+    int one = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&one), sizeof(one));
+}
+
+inline void set_receive_timeout(socket_t s, int timeout_ms) {
+    // recv on s fails once the peer sends nothing for timeout_ms, so recv_all cannot block
+    // forever.
+#ifdef _WIN32
+    DWORD timeout = DWORD(timeout_ms);
+#else
+    timeval timeout{timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+#endif
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+}
+
+inline socket_t listen_tcp(int port, std::uint32_t address) {
+    // Listens on one IPv4 address in host byte order: INADDR_LOOPBACK for local clients only,
+    // INADDR_ANY for all interfaces. Returns invalid_socket on failure.
+    socket_t s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s == invalid_socket)
+        return s;
+
+    int one = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&one), sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(address);
+    addr.sin_port        = htons(std::uint16_t(port));
+
+    if (bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(s, 64) != 0) {
+        close_socket(s);
+        return invalid_socket;
+    }
+    return s;
+}
+
+inline socket_t connect_tcp(const std::string& host, int port) {
+    // Returns invalid_socket if the host cannot be resolved or reached.
+    addrinfo hints{};
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* found = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &found) != 0)
+        return invalid_socket;
+
+    socket_t s = invalid_socket;
+    for (auto* a = found; a && s == invalid_socket; a = a->ai_next) {
+        s = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (s != invalid_socket && connect(s, a->ai_addr, int(a->ai_addrlen)) != 0) {
+            close_socket(s);
+            s = invalid_socket;
+        }
+    }
+    freeaddrinfo(found);
+
+    if (s != invalid_socket)
+        set_no_delay(s);
+    return s;
+}
+
+inline bool send_all(socket_t s, const void* data, size_t size) {
+    // False once the peer is gone; never raises SIGPIPE.
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;
+#endif
+    auto bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        auto sent = send(s, bytes, int(size), flags);
+        if (sent <= 0)
+            return false;
+        bytes += sent;
+        size  -= size_t(sent);
+    }
+    return true;
+}
+
+inline bool recv_all(socket_t s, void* data, size_t size) {
+    // False if the peer closes the connection before size bytes arrive, or stalls longer than
+    // the socket's receive timeout.
+    auto bytes = static_cast<char*>(data);
+    while (size > 0) {
+        auto got = recv(s, bytes, int(size), 0);
+        if (got <= 0)
+            return false;
+        bytes += got;
+        size  -= size_t(got);
+    }
+    return true;
+}
+
+
+#endif
@@ -0,0 +1,223 @@
+#ifndef PHOTON_MAP_H
+#define PHOTON_MAP_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include "camera.h"
+#include "framebuffer.h"
+#include "hittable.h"
+#include "material.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+
+inline bool is_specular(const material& mat) {
+    // Materials that scatter into a narrow lobe, which a diffuse path almost never samples.
+    return mat.kind() == material_kind::metal || mat.kind() == material_kind::dielectric;
+}
+
+
+// Caustic photon map (Jensen 1996). The sky is the only emitter: photons are shot from it at
+// a target sphere that encloses the specular objects, follow specular and dielectric chains,
+// and are stored where they land on a diffuse surface after at least one specular bounce.
+// The stored photons live in a balanced kd-tree, built in parallel, and caustic radiance at a
+// diffuse hit is estimated from the photons within gather_radius.
+class photon_map {
+  public:
+    int    photon_count  = 200000;          // Photons shot from the sky
+    double gather_radius = 0.1;             // Radius of the density estimate, world units
+    point3 target_center = point3(0,0,0);   // Sphere enclosing the specular objects
+    double target_radius = 1;
+    int    max_depth     = 10;              // Bounces followed per photon
+
+    struct photon {
+        point3 p;
+        vec3   incoming;  // Direction of travel when stored
+        color  power;
+    };
+
+    size_t size() const { return photons.size(); }
+
+    void build(const hittable& world, std::uint32_t seed = 1) {
+        // Traces photon_count photons and builds the kd-tree.
+        const int chunk = 4096;
+        int chunks = (photon_count + chunk - 1) / chunk;
+        std::vector<std::vector<photon>> stored(chunks);
+
+        // Photons leave a disk of radius target_radius facing their direction, which covers
+        // the target sphere; directions are uniform over the upper sky.
+        double flux_scale = (pi * target_radius * target_radius) * (2*pi) / photon_count;
+
+        parallel_for(chunks, [&](int c) {
+            seed_random({seed, std::uint32_t(c)});
+            int count = std::min(chunk, photon_count - c * chunk);
+            for (int n = 0; n < count; n++)
+                trace_photon(world, flux_scale, stored[c]);
+        });
+
+        photons.clear();
+        for (const auto& s : stored)
+            photons.insert(photons.end(), s.begin(), s.end());
+
+        axes.assign(photons.size(), 0);
+        balance(0, photons.size(), thread_count());
+    }
+
+    color caustic_radiance(const hit_record& rec) const {
+        // Radiance leaving a lambertian hit towards any direction due to caustic photons.
+        color flux(0,0,0);
+        gather(0, photons.size(), rec.p, rec.normal, flux);
+        return rec.mat->aov_albedo() / pi * flux / (pi * gather_radius * gather_radius);
+    }
+
+  private:
+    std::vector<photon>       photons;  // kd-tree: each range's median is its splitting node
+    std::vector<std::uint8_t> axes;     // Splitting axis of each node
+
+    void trace_photon(const hittable& world, double flux_scale, std::vector<photon>& out) const {
+        // Direction pointing down into the scene; the light comes from the sky along -d.
+        vec3 d = random_unit_vector();
+        if (d.y() > 0)
+            d = vec3(d.x(), -d.y(), d.z());
+
+        vec3 a = std::fabs(d.x()) > 0.9 ? vec3(0,1,0) : vec3(1,0,0);
+        vec3 u = unit_vector(cross(d, a));
+        vec3 v = cross(d, u);
+        auto offset = target_radius * random_in_unit_disk();
+        point3 origin = target_center - 2 * target_radius * d + offset.x() * u + offset.y() * v;
+
+        ray r(origin, d);
+        color power = flux_scale * camera::background(ray(origin, -d));
+        int specular_bounces = 0;
+
+        for (int bounce = 0; bounce < max_depth; bounce++) {
+            hit_record rec;
+            if (!world.hit(r, interval(0.001, infinity), rec))
+                return;
+
+            if (!is_specular(*rec.mat)) {
+                if (specular_bounces > 0)
+                    out.push_back({rec.p, r.direction(), power});
+                return;
+            }
+
+            ray scattered;
+            color attenuation;
+            if (!rec.mat->scatter(r, rec, attenuation, scattered))
+                return;
+            power = power * attenuation;
+            r = scattered;
+            specular_bounces++;
+        }
+    }
+
+    void balance(size_t lo, size_t hi, int threads) {
+        // Median split on the axis of largest extent; the two halves are built in parallel
+        // while there are threads to spare.
+        if (hi - lo < 2)
+            return;
+
+        point3 low(infinity, infinity, infinity), high(-infinity, -infinity, -infinity);
+        for (size_t i = lo; i < hi; i++)
+            for (int c = 0; c < 3; c++) {
+                low[c]  = std::min(low[c], photons[i].p[c]);
+                high[c] = std::max(high[c], photons[i].p[c]);
+            }
+        auto extent = high - low;
+        int axis = extent.x() > extent.y() ? (extent.x() > extent.z() ? 0 : 2)
+                                           : (extent.y() > extent.z() ? 1 : 2);
+
+        size_t mid = lo + (hi - lo) / 2;
+        std::nth_element(photons.begin() + lo, photons.begin() + mid, photons.begin() + hi,
+                         [axis](const photon& a, const photon& b) { return a.p[axis] < b.p[axis]; });
+        axes[mid] = std::uint8_t(axis);
+
+        if (threads > 1 && hi - lo > 10000) {
+            std::thread left([&] { balance(lo, mid, threads / 2); });
+            balance(mid + 1, hi, threads - threads / 2);
+            left.join();
+        } else {
+            balance(lo, mid, 1);
+            balance(mid + 1, hi, 1);
+        }
+    }
+
+    void gather(size_t lo, size_t hi, const point3& p, const vec3& n, color& flux) const {
+        if (lo >= hi)
+            return;
+
+        size_t mid = lo + (hi - lo) / 2;
+        const auto& ph = photons[mid];
+        if ((ph.p - p).length_squared() < gather_radius * gather_radius
+            && dot(ph.incoming, n) < 0)
+            flux += ph.power;
+
+        if (hi - lo == 1)
+            return;
+        int axis = axes[mid];
+        double delta = p[axis] - ph.p[axis];
+        if (delta < gather_radius)
+            gather(lo, mid, p, n, flux);
+        if (delta > -gather_radius)
+            gather(mid + 1, hi, p, n, flux);
+    }
+};
+
+
+inline color photon_ray_color(const camera& cam, const ray& r, int depth, const hittable& world,
+                              const photon_map& caustics, int chain = 0) {
+    // Path tracing with caustics taken from the photon map, which are added at every
+    // lambertian hit. To avoid counting them twice, paths that reach the sky through specular
+    // bounces only, right after a diffuse bounce, contribute nothing. chain tracks this: 0
+    // before any diffuse bounce, 1 right after one, 2 after a diffuse then specular bounces.
+    if (depth <= 0)
+        return color(0,0,0);
+
+    hit_record rec;
+    if (!world.hit(r, interval(0.001, infinity), rec))
+        return chain == 2 ? color(0,0,0) : camera::background(r);
+
+    ray scattered;
+    color attenuation;
+    bool diffuse = !is_specular(*rec.mat);
+    if (!rec.mat->scatter(r, rec, attenuation, scattered))
+        return color(0,0,0);
+
+    int next = diffuse ? 1 : (chain == 0 ? 0 : 2);
+    color result = attenuation * photon_ray_color(cam, scattered, depth-1, world, caustics, next);
+    if (diffuse)
+        result += caustics.caustic_radiance(rec);
+    return result;
+}
+
+inline void render_with_caustics(camera& cam, const hittable& world, const photon_map& caustics,
+                                 framebuffer& fb, std::uint32_t seed = 1) {
+    // Renders the beauty image into fb, rows in parallel.
+    cam.initialize();
+    fb.resize(cam.image_width, cam.height());
+
+    parallel_for(cam.height(), [&](int j) {
+        seed_random({seed, std::uint32_t(j)});
+        for (int i = 0; i < cam.image_width; i++) {
+            auto p = fb.index(i, j);
+            for (int s = 0; s < cam.samples_per_pixel; s++) {
+                fb.beauty[p] += photon_ray_color(cam, cam.get_ray(i, j), cam.max_depth, world, caustics);
+                fb.samples[p]++;
+            }
+        }
+    });
+}
+
+
+#endif
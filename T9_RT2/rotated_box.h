@@ -0,0 +1,130 @@
+#ifndef ROTATED_BOX_H
+#define ROTATED_BOX_H
+
+#include "rtweekend.h"
+#include "hittable.h"
+
+// esta es la clase para hacer rotar los vectores
+class rotation {
+public:
+    rotation() : rotation_matrix{ 1,0,0,0,1,0,0,0,1 } {}
+
+    rotation(double angle_x, double angle_y, double angle_z) {
+        // se crean matrices de rotacin individuales
+        double matrix_x[9] = {
+            1, 0, 0,
+            0, cos(angle_x), -sin(angle_x),
+            0, sin(angle_x), cos(angle_x)
+        };
+
+        double matrix_y[9] = {
+            cos(angle_y), 0, sin(angle_y),
+            0, 1, 0,
+            -sin(angle_y), 0, cos(angle_y)
+        };
+
+        double matrix_z[9] = {
+            cos(angle_z), -sin(angle_z), 0,
+            sin(angle_z), cos(angle_z), 0,
+            0, 0, 1
+        };
+
+        // aqui multiplicamos las matrices para obtener la rotacin completa
+        double temp[9];
+        matrix_multiply(matrix_y, matrix_x, temp);
+        matrix_multiply(matrix_z, temp, rotation_matrix);
+    }
+
+    vec3 rotate(const vec3& v) const {
+        return vec3(
+            rotation_matrix[0] * v.x() + rotation_matrix[1] * v.y() + rotation_matrix[2] * v.z(),
+            rotation_matrix[3] * v.x() + rotation_matrix[4] * v.y() + rotation_matrix[5] * v.z(),
+            rotation_matrix[6] * v.x() + rotation_matrix[7] * v.y() + rotation_matrix[8] * v.z()
+        );
+    }
+
+private:
+    double rotation_matrix[9];
+
+    void matrix_multiply(const double A[9], const double B[9], double C[9]) {
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                C[i * 3 + j] = 0;
+                for (int k = 0; k < 3; k++) {
+                    C[i * 3 + j] += A[i * 3 + k] * B[k * 3 + j];
+                }
+            }
+        }
+    }
+};
+
+// esta es la clase del cubo que debe estar rotado
+class rotated_box : public hittable {
+public:
+    rotated_box() {}
+    rotated_box(point3 center, double size, shared_ptr<material> m, rotation r)
+        : center(center), half_size(size / 2), mat(m), rot(r) {
+    }
+
+    virtual bool hit(const ray& r, interval ray_t, hit_record& rec) const override {
+        point3 origin = r.origin() - center;
+        vec3 dir_inv = vec3(-rot.rotate(-r.direction()).x(), -rot.rotate(-r.direction()).y(), -rot.rotate(-r.direction()).z());
+        point3 orig_inv = vec3(-rot.rotate(-origin).x(), -rot.rotate(-origin).y(), -rot.rotate(-origin).z());
+        vec3 dir = -dir_inv;
+        point3 orig = -orig_inv;
+
+        double t_min = ray_t.min;
+        double t_max = ray_t.max;
+
+        for (int a = 0; a < 3; a++) {
+            auto invD = 1.0f / dir[a];
+            auto t0 = (-half_size - orig[a]) * invD;
+            auto t1 = (half_size - orig[a]) * invD;
+
+            if (invD < 0.0f)
+                std::swap(t0, t1);
+
+            t_min = t0 > t_min ? t0 : t_min;
+            t_max = t1 < t_max ? t1 : t_max;
+
+            if (t_max <= t_min)
+                return false;
+        }
+
+
+        rec.t = t_min;
+        rec.p = r.at(rec.t);
+        point3 local_p = rot.rotate(rec.p - center);
+        vec3 outward_normal;
+
+        double eps = 1e-8;
+        if (std::abs(local_p.x() - half_size) < eps)
+            outward_normal = rot.rotate(vec3(1, 0, 0));
+        else if (std::abs(local_p.x() + half_size) < eps)
+            outward_normal = rot.rotate(vec3(-1, 0, 0));
+        else if (std::abs(local_p.y() - half_size) < eps)
+            outward_normal = rot.rotate(vec3(0, 1, 0));
+        else if (std::abs(local_p.y() + half_size) < eps)
+            outward_normal = rot.rotate(vec3(0, -1, 0));
+        else if (std::abs(local_p.z() - half_size) < eps)
+            outward_normal = rot.rotate(vec3(0, 0, 1));
+        else
+            outward_normal = rot.rotate(vec3(0, 0, -1));
+
+        rec.set_face_normal(r, outward_normal);
+        rec.mat = mat;
+
+        return true;
+    }
+
+    // para editar la escena sin reconstruir el cubo
+    void set_material(shared_ptr<material> m) { mat = m; }
+
+private:
+    point3 center;
+    double half_size;
+    shared_ptr<material> mat;
+    rotation rot;
+};
+
+#endif
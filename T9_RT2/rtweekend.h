@@ -10,10 +10,13 @@
 //==============================================================================================
 
 #include <cmath>
+#include <cstdint>
 #include <cstdlib>
+#include <initializer_list>
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <random>
 
 
 // C++ Std Usings
@@ -34,9 +37,22 @@ inline double degrees_to_radians(double degrees) {
     return degrees * pi / 180.0;
 }
 
+inline std::mt19937& random_engine() {
+    // Per-thread generator, so parallel renders neither share state nor contend for a lock.
+    thread_local std::mt19937 engine;
+    return engine;
+}
+
+inline void seed_random(std::initializer_list<std::uint32_t> keys) {
+    // Restarts this thread's generator from the given keys (e.g. seed, pass and tile number),
+    // which makes a piece of work reproducible no matter which thread runs it.
+    std::seed_seq seq(keys);
+    random_engine().seed(seq);
+}
+
 inline double random_double() {
     // Returns a random real in [0,1).
-    return std::rand() / (RAND_MAX + 1.0);
+    return random_engine()() / (std::mt19937::max() + 1.0);
 }
 
 inline double random_double(double min, double max) {
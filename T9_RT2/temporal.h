@@ -0,0 +1,148 @@
+#ifndef TEMPORAL_H
+#define TEMPORAL_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include "camera.h"
+#include "framebuffer.h"
+#include "hittable.h"
+#include "material.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+
+// Renders the frames of a camera-only animation of a static scene, reusing the accumulated
+// radiance of the previous frame. Each frame first traces one ray through every pixel center
+// to find the surface it sees. That point is projected into the previous camera, and the
+// previous frame's pixels around it are blended bilinearly. Each neighbour counts only if its
+// mean first-hit depth is within depth_threshold (relative) of the point's distance from the
+// previous camera and its mean normal is similar. Means over all of a pixel's samples also
+// reject pixels that straddle a silhouette, whose mixed color would otherwise be dragged
+// along as the camera moves. Pixels with valid history take history_samples new samples;
+// the others take the camera's samples_per_pixel.
+//
+// Only lambertian surfaces reuse history: their radiance does not depend on the view
+// direction, while reflections and refractions move across metal and glass as the camera
+// does. Cameras with defocus blur are not supported.
+class temporal_renderer {
+  public:
+    double        depth_threshold  = 0.05;  // Largest relative depth difference of valid history
+    double        normal_threshold = 0.95;  // Smallest cosine between normals of valid history
+    int           history_samples  = 1;     // New samples per pixel where history is valid
+    int           max_history      = 64;    // Samples of history carried over at most
+    std::uint32_t seed             = 1;
+
+    framebuffer fb;  // Accumulation of the last frame
+
+    int reused_pixels = 0;  // Pixels of the last frame that took history
+    int frame         = 0;  // Frames rendered so far
+
+    bool render_frame(camera& cam, const hittable& world) {
+        // Returns false, rendering nothing, for cameras with defocus blur.
+        if (cam.defocus_angle > 0)
+            return false;
+
+        cam.initialize();
+        int width = cam.image_width, height = cam.height();
+        bool history = frame > 0 && fb.width == width && fb.height == height;
+
+        framebuffer next;
+        next.resize(width, height);
+        std::vector<char> reusable(size_t(width) * height, 0);
+        std::atomic<int> reused{0};
+
+        parallel_for(height, [&](int j) {
+            seed_random({seed, std::uint32_t(frame), std::uint32_t(j)});
+            for (int i = 0; i < width; i++) {
+                auto p = next.index(i, j);
+
+                // Surface seen through the pixel center; the sky and speculars are always fresh.
+                ray r = cam.get_ray(i, j, vec3(0,0,0));
+                hit_record rec;
+                reusable[p] = cam.max_depth > 0 && world.hit(r, interval(0.001, infinity), rec)
+                           && rec.mat->kind() == material_kind::lambertian;
+
+                int fresh = cam.samples_per_pixel;
+                color radiance;
+                int count;
+                if (history && reusable[p] && reproject(rec, radiance, count)) {
+                    next.beauty[p] = count * radiance;
+                    next.albedo[p] = count * rec.mat->aov_albedo();
+                    next.normal[p] = count * rec.normal;
+                    next.depth[p]  = count * rec.t * r.direction().length();
+                    next.samples[p] = count;
+                    fresh = history_samples;
+                    reused++;
+                }
+
+                for (int n = 0; n < fresh; n++)
+                    cam.add_sample(i, j, world, next);
+            }
+        });
+
+        fb = std::move(next);
+        lambertian = std::move(reusable);
+        previous = cam;
+        reused_pixels = reused;
+        frame++;
+        return true;
+    }
+
+  private:
+    camera            previous;    // Camera of the last frame
+    std::vector<char> lambertian;  // Pixel centers of the last frame that saw a lambertian
+
+    bool reproject(const hit_record& s, color& radiance, int& count) const {
+        // Bilinear blend of the valid history around the projection of the hit s.
+        double x, y;
+        if (!previous.project(s.p, x, y))
+            return false;
+
+        double expected = (s.p - previous.lookfrom).length();
+        int x0 = int(std::floor(x)), y0 = int(std::floor(y));
+        double fx = x - x0, fy = y - y0;
+
+        double total = 0, samples = 0;
+        radiance = color(0,0,0);
+        for (int dy = 0; dy < 2; dy++) {
+            for (int dx = 0; dx < 2; dx++) {
+                int i = x0 + dx, j = y0 + dy;
+                if (i < 0 || j < 0 || i >= fb.width || j >= fb.height)
+                    continue;
+
+                auto p = fb.index(i, j);
+                if (!lambertian[p] || fb.samples[p] == 0
+                    || std::fabs(fb.depth_at(p) - expected) > depth_threshold * expected
+                    || dot(fb.normal_at(p), s.normal) < normal_threshold)
+                    continue;
+
+                double w = (dx ? fx : 1 - fx) * (dy ? fy : 1 - fy);
+                radiance += w * fb.beauty_at(p);
+                samples += w * fb.samples[p];
+                total += w;
+            }
+        }
+
+        // Require most of the bilinear footprint to be valid, not a sliver of one neighbour.
+        if (total < 0.5)
+            return false;
+
+        radiance /= total;
+        count = std::clamp(int(std::lround(samples / total)), 1, max_history);
+        return true;
+    }
+};
+
+
+#endif
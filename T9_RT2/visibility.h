@@ -0,0 +1,157 @@
+#ifndef VISIBILITY_H
+#define VISIBILITY_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include "camera.h"
+#include "framebuffer.h"
+#include "hittable_list.h"
+#include "parallel.h"
+#include "tiles.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+
+// Renderer for pinhole cameras (defocus_angle == 0) that computes primary hits once. Every
+// pixel is sampled at a fixed pattern of pattern_size jitter offsets, shared by all pixels;
+// sample s uses offset s % pattern_size, so with more samples than offsets each primary ray is
+// traced several times with identical results.
+//
+// A first pass traces those primary rays tile by tile, testing each object against all rays
+// of the tile in turn, and stores the index of the hit object per pixel and offset. Shading
+// then rebuilds the hit record by intersecting only that object and starts the bounces there,
+// so each primary ray costs one object test instead of a walk over the whole world.
+class visibility_renderer {
+  public:
+    int           pattern_size = 16;    // Jitter offsets per pixel
+    int           tile_size    = 16;    // Tile edge in pixels
+    std::uint32_t seed         = 1;     // Seed of the jitter pattern and the per-tile generators
+    bool          use_buffer   = true;  // False traces every primary ray, for comparisons
+
+    framebuffer fb;  // Beauty sums and sample counts
+
+    double visibility_seconds = 0;  // Time of the last visibility pass
+    double shading_seconds    = 0;  // Time of the last shading pass
+
+    bool render(camera& cam, const hittable_list& world) {
+        // Returns false, rendering nothing, for cameras with defocus blur.
+        using clock = std::chrono::steady_clock;
+        if (cam.defocus_angle > 0)
+            return false;
+
+        cam.initialize();
+        fb.resize(cam.image_width, cam.height());
+        tiles = make_tiles(cam.image_width, cam.height(), tile_size);
+        make_pattern();
+
+        auto start = clock::now();
+        visibility.clear();
+        if (use_buffer) {
+            visibility.resize(size_t(fb.width) * fb.height * pattern.size());
+            parallel_for(int(tiles.size()), [&](int t) { trace_visibility(cam, world, tiles[t]); });
+        }
+        auto traced = clock::now();
+
+        parallel_for(int(tiles.size()), [&](int t) { shade_tile(cam, world, t); });
+        auto done = clock::now();
+
+        visibility_seconds = std::chrono::duration<double>(traced - start).count();
+        shading_seconds    = std::chrono::duration<double>(done - traced).count();
+        return true;
+    }
+
+  private:
+    std::vector<tile> tiles;
+    std::vector<vec3> pattern;     // Jitter offsets in [-.5,+.5]
+    std::vector<int>  visibility;  // Hit object per pixel and offset (index in the world list,
+                                   // -1 for the sky), pattern.size() entries per pixel
+
+    void make_pattern() {
+        // Stratified offsets: one random point in each cell of an n x n grid, n*n >= size.
+        int n = int(std::ceil(std::sqrt(double(pattern_size))));
+        seed_random({seed});
+        pattern.clear();
+        for (int k = 0; k < pattern_size; k++) {
+            int cx = k % n, cy = (k / n) % n;
+            pattern.push_back(vec3((cx + random_double()) / n - 0.5,
+                                   (cy + random_double()) / n - 0.5, 0));
+        }
+    }
+
+    size_t visibility_index(int i, int j, int k) const {
+        return (size_t(j) * fb.width + i) * pattern.size() + k;
+    }
+
+    void trace_visibility(const camera& cam, const hittable_list& world, const tile& tl) {
+        // Object-major loop: each object is tested against every primary ray of the tile while
+        // its data is hot. Keeps the closest hit per ray exactly as hittable_list::hit does.
+        std::vector<ray>    rays;
+        std::vector<double> closest;
+        std::vector<size_t> slots;
+        for (int j = tl.y0; j < tl.y1; j++) {
+            for (int i = tl.x0; i < tl.x1; i++) {
+                for (int k = 0; k < int(pattern.size()); k++) {
+                    rays.push_back(cam.get_ray(i, j, pattern[k]));
+                    closest.push_back(infinity);
+                    slots.push_back(visibility_index(i, j, k));
+                    visibility[slots.back()] = -1;
+                }
+            }
+        }
+
+        hit_record rec;
+        for (int object = 0; object < int(world.objects.size()); object++) {
+            const auto& obj = *world.objects[object];
+            for (size_t n = 0; n < rays.size(); n++) {
+                if (obj.hit(rays[n], interval(0.001, closest[n]), rec)) {
+                    closest[n] = rec.t;
+                    visibility[slots[n]] = object;
+                }
+            }
+        }
+    }
+
+    void shade_tile(const camera& cam, const hittable_list& world, int t) {
+        const auto& tl = tiles[t];
+        seed_random({seed, std::uint32_t(t), 1});
+
+        for (int j = tl.y0; j < tl.y1; j++) {
+            for (int i = tl.x0; i < tl.x1; i++) {
+                auto p = fb.index(i, j);
+                for (int s = 0; s < cam.samples_per_pixel; s++) {
+                    int k = s % int(pattern.size());
+                    ray r = cam.get_ray(i, j, pattern[k]);
+                    fb.samples[p]++;
+
+                    if (!use_buffer) {
+                        fb.beauty[p] += cam.ray_color(r, cam.max_depth, world);
+                        continue;
+                    }
+
+                    int object = visibility[visibility_index(i, j, k)];
+                    hit_record rec;
+                    if (object < 0) {
+                        fb.beauty[p] += camera::background(r);
+                    } else if (cam.max_depth > 0
+                               && world.objects[object]->hit(r, interval(0.001, infinity), rec)) {
+                        // An object's own nearest hit is the one the visibility pass kept.
+                        rec.object = object;
+                        fb.beauty[p] += cam.shade(r, rec, cam.max_depth, world);
+                    }
+                }
+            }
+        }
+    }
+};
+
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef WAVEFRONT_H
+#define WAVEFRONT_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include "camera.h"
+#include "material.h"
+
+#include <chrono>
+#include <type_traits>
+#include <vector>
+
+
+// Breadth-first alternative to camera::ray_color. Instead of following one path to the end,
+// a whole batch of paths advances one bounce at a time: every ray of the batch is intersected,
+// the hits are binned by material kind, each bin runs its scatter as a tight non-virtual loop,
+// and the surviving paths are compacted and topped up with fresh camera rays.
+class wavefront_renderer {
+  public:
+    int batch_size = 65536;  // Number of paths in flight per wave
+
+    // Statistics of the last render.
+    long long rays_traced = 0;  // Rays intersected against the world
+    double    seconds     = 0;  // Wall-clock render time
+
+    double mrays_per_second() const {
+        return seconds > 0 ? rays_traced / seconds * 1e-6 : 0;
+    }
+
+    void render(camera& cam, const hittable& world) {
+        auto start = std::chrono::steady_clock::now();
+
+        cam.initialize();
+        int width  = cam.image_width;
+        int height = cam.height();
+        int spp    = cam.samples_per_pixel;
+
+        std::vector<color> accum(size_t(width) * height, color(0,0,0));
+
+        long long total_samples = (long long)(width) * height * spp;
+        long long next_sample   = 0;
+        size_t    batch         = batch_size < 1 ? 1 : size_t(batch_size);
+
+        paths.clear();
+        rays_traced = 0;
+
+        while (true) {
+            // Top the queue up with camera rays. Samples are numbered pixel-major, so the
+            // samples of one pixel and its neighbours enter the same wave.
+            while (paths.size() < batch && next_sample < total_samples) {
+                int pixel = int(next_sample / spp);
+                paths.push_back({cam.get_ray(pixel % width, pixel / width), color(1,1,1),
+                                 pixel, cam.max_depth});
+                next_sample++;
+            }
+
+            if (paths.empty())
+                break;
+
+            std::clog << "\rSamples remaining: " << (total_samples - next_sample) << ' '
+                      << std::flush;
+
+            // Intersect the whole wave and bin the hits by material kind.
+            hits.resize(paths.size());
+            alive.assign(paths.size(), 0);
+            for (auto& bin : bins)
+                bin.clear();
+
+            for (size_t k = 0; k < paths.size(); k++) {
+                if (world.hit(paths[k].r, interval(0.001, infinity), hits[k]))
+                    bins[int(hits[k].mat->kind())].push_back(k);
+                else
+                    accum[paths[k].pixel] += paths[k].throughput * camera::background(paths[k].r);
+            }
+            rays_traced += paths.size();
+
+            // Scatter each bin with its own loop.
+            scatter_bin<lambertian>(bins[int(material_kind::lambertian)]);
+            scatter_bin<metal>(bins[int(material_kind::metal)]);
+            scatter_bin<dielectric>(bins[int(material_kind::dielectric)]);
+            scatter_bin<material>(bins[int(material_kind::other)]);
+
+            // Compact the survivors, keeping their order.
+            size_t live = 0;
+            for (size_t k = 0; k < paths.size(); k++)
+                if (alive[k])
+                    paths[live++] = paths[k];
+            paths.resize(live);
+        }
+
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "P3\n" << width << ' ' << height << "\n255\n";
+        for (const auto& pixel_color : accum)
+            write_color(std::cout, pixel_color / spp);
+
+        std::clog << "\rDone. " << rays_traced << " rays, " << mrays_per_second()
+                  << " Mrays/s      \n";
+    }
+
+  private:
+    struct path_state {
+        ray   r;           // Ray to trace in the next wave
+        color throughput;  // Product of the attenuations so far
+        int   pixel;       // Pixel index the path contributes to
+        int   depth;       // Remaining bounces, as in camera::ray_color
+    };
+
+    std::vector<path_state> paths;
+    std::vector<hit_record> hits;
+    std::vector<char>       alive;
+    std::vector<size_t>     bins[4];
+
+    template <typename M>
+    void scatter_bin(const std::vector<size_t>& bin) {
+        // M::scatter is named explicitly so the call is resolved statically within a bin;
+        // for the catch-all bin (M = material) this is still a virtual call.
+        for (size_t k : bin) {
+            auto& path = paths[k];
+            const auto& rec = hits[k];
+            const M& mat = static_cast<const M&>(*rec.mat);
+
+            ray scattered;
+            color attenuation;
+            bool scatters = std::is_same<M, material>::value
+                          ? mat.scatter(path.r, rec, attenuation, scattered)
+                          : mat.M::scatter(path.r, rec, attenuation, scattered);
+
+            if (scatters && path.depth > 1) {
+                path.r = scattered;
+                path.throughput = path.throughput * attenuation;
+                path.depth--;
+                alive[k] = 1;
+            }
+        }
+    }
+};
+
+
+#endif
@@ -0,0 +1,382 @@
+// Erosin por lotes sin ventana ni GPU: carga un mapa de alturas, aplica varias rondas de
+// gotas con ErosionEngine (o de PipeErosion), opcionalmente seguidas de erosin trmica, y
+// guarda el resultado.
+//
+//   ErosionCLI <entrada> <salida> [opciones]
+//
+// La entrada puede ser una imagen (PGM, o PNG, JPEG, TGA... si se compil con el
+// TextureLoader de Diligent), las alturas que el tutorial guarda junto a una imagen (.h16), un
+// RAW de 16 bits, que necesita --size, o un archivo de tiles (.tiles). La salida es un RAW de 16 bits, o un PGM de 16 bits
+// si termina en .pgm.
+//
+// Si la salida termina en .tiles, la entrada se convierte a un archivo de tiles con mips (un
+// RAW se lee por franjas, sin cargarlo entero) y se erosiona por ventanas con ErodeTiled(),
+// as que el mapa puede ser mayor que la memoria. Con la misma entrada y salida .tiles el
+// archivo se erosiona en el sitio.
+
+#include "ErosionEngine.hpp"
+#include "HeightmapImage.hpp"
+#include "PipeErosion.hpp"
+#include "ThermalErosion.hpp"
+#include "TiledTerrain.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+using namespace Diligent;
+
+namespace
+{
+
+bool EndsWith(const std::string& str, const char* suffix)
+{
+    size_t len = std::strlen(suffix);
+    return str.size() >= len && str.compare(str.size() - len, len, suffix) == 0;
+}
+
+void PrintUsage()
+{
+    std::printf(
+        "Uso: ErosionCLI <entrada> <salida> [opciones]\n"
+        "  <entrada>           imagen (PGM, .h16; PNG, JPEG, TGA... con el TextureLoader), RAW\n"
+        "                      de 16 bits (.raw, requiere --size) o archivo de tiles (.tiles)\n"
+        "  <salida>            RAW de 16 bits, PGM de 16 bits si termina en .pgm, o archivo de\n"
+        "                      tiles erosionado por ventanas si termina en .tiles\n"
+        "  --size AxB          ancho y alto de una entrada RAW\n"
+        "  --iterations N      rondas de erosin (10)\n"
+        "  --droplets N        gotas por ronda, o por ventana completa con salida .tiles (10000)\n"
+        "  --threads N         hilos (todos los ncleos)\n"
+        "  --seed N            semilla; sin ella cada ejecucin es distinta\n"
+        "  --radius R          radio de erosin (4)\n"
+        "  --inertia F         persistencia de la direccin (0.3)\n"
+        "  --capacity F        capacidad de sedimento (8)\n"
+        "  --deposition F      velocidad de deposicin (0.2)\n"
+        "  --erosion F         velocidad de erosin (0.7)\n"
+        "  --evaporation F     tasa de evaporacin (0.02)\n"
+        "  --min-slope F       pendiente mnima (0.01)\n"
+        "  --gravity F         gravedad (10)\n"
+        "  --max-path N        pasos mximos por gota (64)\n"
+        "  --solver S          gotas (por defecto) o tuberias, el modelo de rejilla\n"
+        "  --pipe-steps N      pasos de tuberas por ronda (50)\n"
+        "  --thermal N         iteraciones de erosin trmica tras cada ronda (0)\n"
+        "  --talus F           ngulo del talud en grados para la erosin trmica (30)\n"
+        "  --tile-size N       celdas del lado de los tiles de un archivo nuevo (256)\n"
+        "  --window N          lado de las ventanas de la erosin por tiles (1024)\n"
+        "  --margin N          margen de cada ventana, mezclado con sus vecinas (64)\n"
+        "  --benchmark         mide gotas/s con 1 hilo y con todos antes de erosionar\n");
+}
+
+// Deja en terrain el archivo de tiles de salida con las alturas de la entrada
+bool OpenTiledOutput(const std::string& input,
+                     const std::string& output,
+                     unsigned int       rawWidth,
+                     unsigned int       rawHeight,
+                     unsigned int       tileSize,
+                     TiledTerrain&      terrain)
+{
+    if (EndsWith(input, ".tiles"))
+    {
+        if (input == output)
+            return terrain.Open(output, true);
+
+        // Copiar el nivel 0 por franjas y recalcular los mips
+        TiledTerrain source;
+        if (!source.Open(input, false) || !terrain.Create(output, source.GetWidth(), source.GetHeight(), source.GetTileSize()))
+            return false;
+        std::vector<float> strip;
+        for (unsigned int y = 0; y < source.GetHeight(); y += source.GetTileSize())
+        {
+            const unsigned int rows = std::min(source.GetTileSize(), source.GetHeight() - y);
+            strip.resize(static_cast<size_t>(source.GetWidth()) * rows);
+            source.ReadRegion(0, 0, static_cast<int>(y), source.GetWidth(), rows, strip.data(), source.GetWidth());
+            terrain.WriteRegion(0, y, source.GetWidth(), rows, strip.data(), source.GetWidth());
+        }
+        terrain.UpdateMips();
+        return true;
+    }
+
+    if (EndsWith(input, ".raw") || EndsWith(input, ".r16"))
+    {
+        if (rawWidth == 0 || rawHeight == 0)
+        {
+            std::fprintf(stderr, "Una entrada RAW necesita --size AxB\n");
+            return false;
+        }
+        return terrain.Create(output, rawWidth, rawHeight, tileSize) && terrain.ImportRaw16(input);
+    }
+
+    // Una imagen se decodifica entera en memoria
+    std::vector<float> heights;
+    unsigned int       width = 0, height = 0;
+    if (!LoadHeightmapImage(input.c_str(), heights, width, height) || !terrain.Create(output, width, height, tileSize))
+        return false;
+    terrain.WriteRegion(0, 0, width, height, heights.data(), width);
+    terrain.UpdateMips();
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const std::string input  = argv[1];
+    const std::string output = argv[2];
+
+    ErosionEngine engine;
+    ErosionParams& params     = engine.Params;
+    int            iterations = 10;
+    unsigned int   seed       = std::random_device{}();
+    unsigned int   rawWidth   = 0;
+    unsigned int   rawHeight  = 0;
+    bool           benchmark  = false;
+    bool           pipes      = false;
+    unsigned int   tileSize   = TiledTerrain::DefaultTileSize;
+    unsigned int   windowSize = 1024;
+    unsigned int   margin     = 64;
+    PipeErosion    pipeSolver;
+    ThermalErosion thermal;
+    thermal.Params.iterations = 0;
+
+    for (int i = 3; i < argc; ++i)
+    {
+        const std::string option = argv[i];
+        if (option == "--benchmark")
+        {
+            benchmark = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            std::fprintf(stderr, "Falta el valor de %s\n", option.c_str());
+            return 1;
+        }
+
+        const char* value = argv[++i];
+        if (option == "--size")
+        {
+            if (std::sscanf(value, "%ux%u", &rawWidth, &rawHeight) != 2)
+            {
+                std::fprintf(stderr, "Tamao invlido: %s\n", value);
+                return 1;
+            }
+        }
+        else if (option == "--iterations")
+            iterations = std::atoi(value);
+        else if (option == "--droplets")
+            params.dropletCount = std::atoi(value);
+        else if (option == "--threads")
+            engine.NumThreads = std::max(1, std::atoi(value));
+        else if (option == "--seed")
+            seed = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+        else if (option == "--radius")
+            params.radius = static_cast<float>(std::atof(value));
+        else if (option == "--inertia")
+            params.inertia = static_cast<float>(std::atof(value));
+        else if (option == "--capacity")
+            params.capacity = static_cast<float>(std::atof(value));
+        else if (option == "--deposition")
+            params.deposition = static_cast<float>(std::atof(value));
+        else if (option == "--erosion")
+            params.erosion = static_cast<float>(std::atof(value));
+        else if (option == "--evaporation")
+            params.evaporation = static_cast<float>(std::atof(value));
+        else if (option == "--min-slope")
+            params.minSlope = static_cast<float>(std::atof(value));
+        else if (option == "--gravity")
+            params.gravity = static_cast<float>(std::atof(value));
+        else if (option == "--max-path")
+            params.maxPath = std::atoi(value);
+        else if (option == "--solver" && (std::strcmp(value, "gotas") == 0 || std::strcmp(value, "tuberias") == 0))
+            pipes = std::strcmp(value, "tuberias") == 0;
+        else if (option == "--pipe-steps")
+            pipeSolver.Params.stepsPerIteration = std::max(1, std::atoi(value));
+        else if (option == "--thermal")
+            thermal.Params.iterations = std::max(0, std::atoi(value));
+        else if (option == "--talus")
+            thermal.Params.talusAngle = static_cast<float>(std::atof(value));
+        else if (option == "--tile-size")
+            tileSize = static_cast<unsigned int>(std::max(16, std::atoi(value)));
+        else if (option == "--window")
+            windowSize = static_cast<unsigned int>(std::max(64, std::atoi(value)));
+        else if (option == "--margin")
+            margin = static_cast<unsigned int>(std::max(0, std::atoi(value)));
+        else
+        {
+            std::fprintf(stderr, "Opcin desconocida: %s\n", option.c_str());
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    // Erosin por ventanas de un archivo de tiles
+    if (EndsWith(output, ".tiles"))
+    {
+        TiledTerrain terrain;
+        if (!OpenTiledOutput(input, output, rawWidth, rawHeight, tileSize, terrain))
+        {
+            std::fprintf(stderr, "No se pudo convertir %s en %s\n", input.c_str(), output.c_str());
+            return 1;
+        }
+        thermal.Params.heightScale = terrain.GetWidth() / 25.0f;
+        std::printf("%s: %ux%u en tiles de %u, %u niveles, ventanas de %u + %u de margen, %d rondas, %d hilos\n", output.c_str(),
+                    terrain.GetWidth(), terrain.GetHeight(), terrain.GetTileSize(), terrain.GetLevelCount(), windowSize, margin,
+                    iterations, engine.NumThreads);
+
+        // Cada ronda pasa por todas las ventanas; cada ventana recibe una ronda del modelo
+        // elegido, con su propia semilla y con las gotas proporcionales a su rea, para que
+        // las ventanas recortadas por el borde del mapa no se erosionen ms que las dems
+        const float  fullWindow   = static_cast<float>(windowSize + 2 * margin) * static_cast<float>(windowSize + 2 * margin);
+        unsigned int window       = 0;
+        float        totalSeconds = 0;
+        for (int i = 0; i < iterations; ++i)
+        {
+            const auto start = std::chrono::high_resolution_clock::now();
+            ErodeTiled(terrain, engine, windowSize, margin, static_cast<unsigned int>(i), [&](ErosionEngine& windowEngine) {
+                if (pipes)
+                {
+                    pipeSolver.Reset();
+                    pipeSolver.Run(windowEngine);
+                }
+                else
+                {
+                    const float area = static_cast<float>(windowEngine.GetWidth()) * static_cast<float>(windowEngine.GetHeight());
+                    windowEngine.Simulate(std::max(1, static_cast<int>(params.dropletCount * area / fullWindow)), seed + window);
+                }
+                windowEngine.ApplyChanges();
+                if (thermal.Params.iterations > 0)
+                {
+                    thermal.Run(windowEngine);
+                    windowEngine.ApplyChanges();
+                }
+                ++window;
+            });
+            const float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+            totalSeconds += seconds;
+            std::printf("Ronda %d: %.2f s, %u ventanas\n", i + 1, seconds, window);
+        }
+        if (iterations > 0)
+            std::printf("Total: %.2f s (%.2f s por ronda)\n", totalSeconds, totalSeconds / iterations);
+
+        if (!terrain.Flush())
+        {
+            std::fprintf(stderr, "No se pudo escribir %s\n", output.c_str());
+            return 1;
+        }
+        std::printf("Guardado en %s\n", output.c_str());
+        return 0;
+    }
+
+    // Cargar el mapa de alturas
+    std::vector<float> heights;
+    unsigned int       width = 0, height = 0;
+    if (EndsWith(input, ".tiles"))
+    {
+        // El nivel 0 completo, para guardarlo como RAW o PGM
+        TiledTerrain terrain;
+        if (!terrain.Open(input, false))
+        {
+            std::fprintf(stderr, "No se pudo leer %s\n", input.c_str());
+            return 1;
+        }
+        width  = terrain.GetWidth();
+        height = terrain.GetHeight();
+        heights.resize(static_cast<size_t>(width) * height);
+        terrain.ReadRegion(0, 0, 0, width, height, heights.data(), width);
+    }
+    else if (EndsWith(input, ".raw") || EndsWith(input, ".r16"))
+    {
+        if (rawWidth == 0 || rawHeight == 0)
+        {
+            std::fprintf(stderr, "Una entrada RAW necesita --size AxB\n");
+            return 1;
+        }
+        width  = rawWidth;
+        height = rawHeight;
+        if (!LoadHeightmapRaw16(input, width, height, heights))
+        {
+            std::fprintf(stderr, "No se pudo leer %s\n", input.c_str());
+            return 1;
+        }
+    }
+    else if (!LoadHeightmapImage(input.c_str(), heights, width, height))
+    {
+        std::fprintf(stderr, "No se pudo leer %s\n", input.c_str());
+        return 1;
+    }
+
+    if (width < 2 || height < 2)
+    {
+        std::fprintf(stderr, "El mapa de alturas debe ser de al menos 2x2\n");
+        return 1;
+    }
+    engine.SetHeightmap(std::move(heights), width, height);
+    thermal.Params.heightScale = width / 25.0f; // Relieve del terreno en el sample: 1/25 del ancho
+    if (pipes)
+        std::printf("%s: %ux%u, %d rondas de %d pasos de tuberas, %d hilos\n", input.c_str(), width, height,
+                    iterations, pipeSolver.Params.stepsPerIteration, engine.NumThreads);
+    else
+        std::printf("%s: %ux%u, %d rondas de %d gotas, %d hilos, semilla %u\n", input.c_str(), width, height,
+                    iterations, params.dropletCount, engine.NumThreads, seed);
+
+    if (benchmark)
+    {
+        ErosionBenchmark result = engine.Benchmark(params.dropletCount, seed);
+        std::printf("1 hilo: %.0f gotas/s, cambio medio %.3e\n", result.SerialRate, result.SerialMeanChange);
+        std::printf("%d hilos: %.0f gotas/s (x%.1f), cambio medio %.3e\n", engine.NumThreads, result.ParallelRate,
+                    result.SerialRate > 0 ? result.ParallelRate / result.SerialRate : 0.0f, result.ParallelMeanChange);
+    }
+
+    // Cada ronda usa su propia semilla derivada de la inicial
+    float totalSeconds = 0;
+    for (int i = 0; i < iterations; ++i)
+    {
+        if (pipes)
+        {
+            pipeSolver.Run(engine);
+            engine.ApplyChanges();
+            totalSeconds += pipeSolver.GetLastSeconds();
+            std::printf("Ronda %d: %.1f ms (%.2f ms/paso), agua %.0f\n", i + 1, pipeSolver.GetLastSeconds() * 1000.0f,
+                        pipeSolver.GetLastSeconds() * 1000.0f / pipeSolver.Params.stepsPerIteration, pipeSolver.GetTotalWater());
+        }
+        else
+        {
+            engine.Simulate(params.dropletCount, seed + static_cast<unsigned int>(i));
+            engine.ApplyChanges();
+            totalSeconds += engine.GetLastSeconds();
+            std::printf("Ronda %d: %.1f ms (%.0f gotas/s)\n", i + 1, engine.GetLastSeconds() * 1000.0f, engine.GetDropletsPerSecond());
+        }
+
+        if (thermal.Params.iterations > 0)
+        {
+            thermal.Run(engine);
+            engine.ApplyChanges();
+            totalSeconds += thermal.GetLastSeconds();
+            std::printf("  Trmica: %.1f ms (%.2f ms/iteracin)\n", thermal.GetLastSeconds() * 1000.0f,
+                        thermal.GetLastSeconds() * 1000.0f / thermal.Params.iterations);
+        }
+    }
+    if (iterations > 0)
+        std::printf("Total: %.2f s (%.1f ms por ronda)\n", totalSeconds, totalSeconds * 1000.0f / iterations);
+
+    // Guardar el resultado
+    bool saved = EndsWith(output, ".pgm") ?
+        SaveHeightmapPGM(output, width, height, engine.GetHeights()) :
+        SaveHeightmapRaw16(output, width, height, engine.GetHeights());
+    if (!saved)
+    {
+        std::fprintf(stderr, "No se pudo escribir %s\n", output.c_str());
+        return 1;
+    }
+    std::printf("Guardado en %s\n", output.c_str());
+    return 0;
+}
@@ -0,0 +1,503 @@
+#include "ErosionEngine.hpp"
+#include "ErosionParallel.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <thread>
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Semilla de la gota nmero droplet de una ronda (mezcla de splitmix64)
+std::uint32_t DropletSeed(std::uint32_t seed, int droplet)
+{
+    std::uint64_t z = (static_cast<std::uint64_t>(seed) << 32 | static_cast<std::uint32_t>(droplet)) + 0x9E3779B97F4A7C15ull;
+    z               = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z               = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return static_cast<std::uint32_t>(z ^ (z >> 31));
+}
+
+} // namespace
+
+void ErosionBrush::Build(float radius)
+{
+    // Kernel gaussiano: peso exp(-d^2 / (2 (radius/3)^2)) para las celdas a distancia
+    // d < radius del centro, con el centro en cada una de las posiciones de subcelda
+    Radius = radius;
+    R      = static_cast<int>(radius);
+    Size   = 2 * R + 1;
+    Weights.assign((SubSteps + 1) * (SubSteps + 1) * Size * Size, 0.0f);
+
+    const float radiusSq = radius * radius;
+    float*      weight   = Weights.data();
+    for (int sy = 0; sy <= SubSteps; ++sy)
+    {
+        for (int sx = 0; sx <= SubSteps; ++sx)
+        {
+            for (int ky = 0; ky < Size; ++ky)
+            {
+                for (int kx = 0; kx < Size; ++kx, ++weight)
+                {
+                    // La celda kx del pincel est en int(x) - R + kx, a dx = fx + R - kx
+                    float dx     = static_cast<float>(sx) / SubSteps + R - kx;
+                    float dy     = static_cast<float>(sy) / SubSteps + R - ky;
+                    float distSq = dx * dx + dy * dy;
+                    if (distSq < radiusSq)
+                        *weight = std::exp(-distSq / (2.0f * radiusSq / 9.0f));
+                }
+            }
+        }
+    }
+}
+
+const float* ErosionBrush::Kernel(float fx, float fy) const
+{
+    int sx = static_cast<int>(fx * SubSteps + 0.5f);
+    int sy = static_cast<int>(fy * SubSteps + 0.5f);
+    return Weights.data() + (sy * (SubSteps + 1) + sx) * Size * Size;
+}
+
+ErosionEngine::ErosionEngine()
+{
+    NumThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+void ErosionEngine::SetHeightmap(std::vector<float> heights, unsigned int width, unsigned int height)
+{
+    m_Width   = width;
+    m_Height  = height;
+    m_Heights = std::move(heights);
+    m_Heights.resize(static_cast<size_t>(width) * height, 0.0f);
+    m_ChangeMap.assign(m_Heights.size(), 0.0f);
+
+    // Todo el mapa es nuevo
+    m_TilesX = (width + TileSize - 1) / TileSize;
+    m_TilesY = (height + TileSize - 1) / TileSize;
+    m_DirtyTiles.assign(static_cast<size_t>(m_TilesX) * m_TilesY, 1);
+}
+
+void ErosionEngine::SetTiles(const std::vector<float>& heights, const std::vector<unsigned int>& tiles)
+{
+    for (unsigned int tile : tiles)
+    {
+        const unsigned int x0 = tile % m_TilesX * TileSize, x1 = std::min(x0 + TileSize, m_Width);
+        const unsigned int y0 = tile / m_TilesX * TileSize, y1 = std::min(y0 + TileSize, m_Height);
+        for (unsigned int y = y0; y < y1; ++y)
+        {
+            size_t row = static_cast<size_t>(y) * m_Width;
+            std::copy(heights.begin() + row + x0, heights.begin() + row + x1, m_Heights.begin() + row + x0);
+        }
+        m_DirtyTiles[tile] = 1;
+    }
+}
+
+void ErosionEngine::SetRegion(unsigned int x, unsigned int y, unsigned int width, unsigned int height, const float* heights, size_t stride)
+{
+    if (width == 0 || height == 0)
+        return;
+
+    for (unsigned int row = 0; row < height; ++row)
+        std::copy(heights + row * stride, heights + row * stride + width, m_Heights.begin() + static_cast<size_t>(y + row) * m_Width + x);
+
+    for (unsigned int ty = y / TileSize; ty <= (y + height - 1) / TileSize; ++ty)
+        for (unsigned int tx = x / TileSize; tx <= (x + width - 1) / TileSize; ++tx)
+            m_DirtyTiles[static_cast<size_t>(ty) * m_TilesX + tx] = 1;
+}
+
+void ErosionEngine::AccumulateChanges(const std::vector<float>& heights, float scale)
+{
+    for (size_t i = 0; i < m_Heights.size(); ++i)
+        m_ChangeMap[i] += heights[i] * scale - m_Heights[i];
+}
+
+float ErosionEngine::SampleHeight(float x, float y) const
+{
+    // Interpolacin bilineal para obtener la altura en una posicin arbitraria
+    int x0 = static_cast<int>(x);
+    int y0 = static_cast<int>(y);
+    int x1 = x0 + 1;
+    int y1 = y0 + 1;
+
+    // Asegurar que las coordenadas estn dentro de los lmites
+    x0 = std::max(0, std::min(x0, static_cast<int>(m_Width) - 1));
+    y0 = std::max(0, std::min(y0, static_cast<int>(m_Height) - 1));
+    x1 = std::max(0, std::min(x1, static_cast<int>(m_Width) - 1));
+    y1 = std::max(0, std::min(y1, static_cast<int>(m_Height) - 1));
+
+    // Calcular factores de interpolacin
+    float tx = x - static_cast<float>(x0);
+    float ty = y - static_cast<float>(y0);
+
+    // Obtener alturas en los cuatro puntos de la cuadrcula
+    float h00 = m_Heights[y0 * m_Width + x0];
+    float h10 = m_Heights[y0 * m_Width + x1];
+    float h01 = m_Heights[y1 * m_Width + x0];
+    float h11 = m_Heights[y1 * m_Width + x1];
+
+    // Interpolar bilinealmente
+    float h0 = (1.0f - tx) * h00 + tx * h10;
+    float h1 = (1.0f - tx) * h01 + tx * h11;
+    return (1.0f - ty) * h0 + ty * h1;
+}
+
+void ErosionEngine::ModifyHeights(std::vector<float>& changeMap, float x, float y, float delta, const ErosionBrush& brush) const
+{
+    // Modificar el mapa de cambios dentro del radio del pincel con los pesos precalculados
+    int xi = static_cast<int>(x);
+    int yi = static_cast<int>(y);
+    int x0 = xi - brush.R;
+    int y0 = yi - brush.R;
+
+    // Recortar el pincel a los lmites del mapa
+    int kx0 = std::max(0, -x0);
+    int ky0 = std::max(0, -y0);
+    int kx1 = std::min(brush.Size, static_cast<int>(m_Width) - x0);
+    int ky1 = std::min(brush.Size, static_cast<int>(m_Height) - y0);
+
+    const float* kernel = brush.Kernel(x - xi, y - yi);
+    for (int ky = ky0; ky < ky1; ++ky)
+    {
+        const float* weights = kernel + ky * brush.Size;
+        float*       cells   = changeMap.data() + static_cast<size_t>(y0 + ky) * m_Width + x0;
+        for (int kx = kx0; kx < kx1; ++kx)
+            cells[kx] += delta * weights[kx];
+    }
+}
+
+void ErosionEngine::Simulate(int dropletCount, unsigned int seed)
+{
+    // Las gotas solo leen m_Heights y escriben en un mapa de cambios, as que son
+    // independientes entre s: cada hilo simula su parte de las gotas sobre su propio mapa
+    // de cambios y al final se suman todos en m_ChangeMap.
+    const auto   start      = std::chrono::high_resolution_clock::now();
+    const int    numThreads = std::max(1, std::min(NumThreads, dropletCount));
+    const size_t mapSize    = m_Heights.size();
+
+    // Los pesos del pincel solo se recalculan cuando cambia el radio
+    if (m_DepositBrush.Radius != 1.0f)
+        m_DepositBrush.Build(1.0f);
+    if (m_ErosionBrush.Radius != Params.radius)
+        m_ErosionBrush.Build(Params.radius);
+
+    m_ThreadChangeMaps.resize(numThreads);
+    ParallelFor(numThreads, numThreads, [&](int first, int last) {
+        for (int t = first; t < last; ++t)
+        {
+            auto& changeMap = m_ThreadChangeMaps[t];
+            changeMap.assign(mapSize, 0.0f);
+
+            for (int i = dropletCount * t / numThreads; i < dropletCount * (t + 1) / numThreads; ++i)
+                SimulateDroplet(seed, i, changeMap);
+        }
+    });
+
+    // Sumar los mapas de los hilos, repartiendo las filas entre los mismos hilos
+    ParallelFor(static_cast<int>(m_Height), numThreads, [&](int firstRow, int lastRow) {
+        size_t begin = static_cast<size_t>(firstRow) * m_Width;
+        size_t end   = static_cast<size_t>(lastRow) * m_Width;
+        for (int t = 0; t < numThreads; ++t)
+            for (size_t i = begin; i < end; ++i)
+                m_ChangeMap[i] += m_ThreadChangeMaps[t][i];
+    });
+
+    m_LastSeconds       = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+    m_DropletsPerSecond = m_LastSeconds > 0 ? dropletCount / m_LastSeconds : 0;
+}
+
+void ErosionEngine::SimulateDroplet(unsigned int seed, int droplet, std::vector<float>& changeMap) const
+{
+    std::minstd_rand                      gen(DropletSeed(seed, droplet));
+    std::uniform_real_distribution<float> posDistX(0, static_cast<float>(m_Width - 1));
+    std::uniform_real_distribution<float> posDistY(0, static_cast<float>(m_Height - 1));
+    std::uniform_real_distribution<float> dirDist(-1.0f, 1.0f);
+
+    // Crear una nueva gota en una posicin aleatoria
+    Droplet drop;
+    drop.x        = posDistX(gen);
+    drop.y        = posDistY(gen);
+    drop.dirX     = 0.0f;
+    drop.dirY     = 0.0f;
+    drop.speed    = 0.0f;
+    drop.water    = 1.0f;
+    drop.sediment = 0.0f;
+
+    // Simular el movimiento de la gota hasta que se evapore o alcance el mximo de pasos
+    for (int lifetime = 0; lifetime < Params.maxPath; ++lifetime)
+    {
+        // Obtener coordenadas enteras y fraccionales
+        int   xi = static_cast<int>(drop.x);
+        int   yi = static_cast<int>(drop.y);
+        float xf = drop.x - xi;
+        float yf = drop.y - yi;
+
+        // Salir si la gota est fuera del mapa. static_cast trunca hacia cero, as que
+        // las posiciones en (-1, 0) se comparan aparte: daran una fraccin negativa
+        if (drop.x < 0 || xi >= static_cast<int>(m_Width - 1) ||
+            drop.y < 0 || yi >= static_cast<int>(m_Height - 1))
+        {
+            break;
+        }
+
+        // Calcular gradiente usando muestras de altura
+        float h00 = m_Heights[yi * m_Width + xi];
+        float h10 = m_Heights[yi * m_Width + xi + 1];
+        float h01 = m_Heights[(yi + 1) * m_Width + xi];
+        float h11 = m_Heights[(yi + 1) * m_Width + xi + 1];
+
+        // Calcular gradiente utilizando interpolacin bilineal
+        float gradX   = (h10 - h00) * (1.0f - yf) + (h11 - h01) * yf;
+        float gradY   = (h01 - h00) * (1.0f - xf) + (h11 - h10) * xf;
+        float gradLen = std::sqrt(gradX * gradX + gradY * gradY);
+
+        // Actualizar direccin basada en el gradiente y la inercia
+        float dirX, dirY;
+        if (gradLen <= FLT_EPSILON)
+        {
+            // Si el gradiente es casi cero, elegir una direccin aleatoria
+            dirX = dirDist(gen);
+            dirY = dirDist(gen);
+        }
+        else
+        {
+            // Combinar la direccin actual con el gradiente negativo (cuesta abajo)
+            dirX = drop.dirX * Params.inertia - gradX / gradLen * (1.0f - Params.inertia);
+            dirY = drop.dirY * Params.inertia - gradY / gradLen * (1.0f - Params.inertia);
+        }
+        float dirLen = std::sqrt(dirX * dirX + dirY * dirY);
+        drop.dirX    = dirLen > 0 ? dirX / dirLen : 0.0f;
+        drop.dirY    = dirLen > 0 ? dirY / dirLen : 0.0f;
+
+        // Calcular la nueva posicin
+        float newX = drop.x + drop.dirX;
+        float newY = drop.y + drop.dirY;
+
+        // Obtener alturas
+        float oldHeight  = SampleHeight(drop.x, drop.y);
+        float newHeight  = SampleHeight(newX, newY);
+        float heightDiff = newHeight - oldHeight;
+
+        // Determinar si deposita o erosiona
+        if (heightDiff > 0)
+        {
+            // Si va cuesta arriba, deposita sedimento para rellenar
+            float depositAmount = std::min(heightDiff, drop.sediment);
+            ModifyHeights(changeMap, drop.x, drop.y, depositAmount, m_DepositBrush);
+            drop.sediment -= depositAmount;
+            drop.speed = 0.0f;
+        }
+        else
+        {
+            // Calcular capacidad de transporte
+            float slope    = std::max(-heightDiff, Params.minSlope);
+            float capacity = slope * drop.speed * drop.water * Params.capacity;
+
+            // Decidir entre depositar o erosionar
+            if (drop.sediment > capacity)
+            {
+                // Depositar exceso de sedimento
+                float depositAmount = (drop.sediment - capacity) * Params.deposition;
+                ModifyHeights(changeMap, drop.x, drop.y, depositAmount, m_DepositBrush);
+                drop.sediment -= depositAmount;
+            }
+            else
+            {
+                // Erosionar el terreno
+                float erosionAmount = std::min(
+                    (capacity - drop.sediment) * Params.erosion,
+                    -heightDiff // No erosionar ms que la diferencia de altura
+                );
+
+                // Distribuir la erosin en un radio
+                ModifyHeights(changeMap, drop.x, drop.y, -erosionAmount, m_ErosionBrush);
+                drop.sediment += erosionAmount;
+            }
+        }
+
+        // Actualizar velocidad y posicin
+        drop.speed = std::sqrt(drop.speed * drop.speed + std::fabs(heightDiff) * Params.gravity);
+        drop.x     = newX;
+        drop.y     = newY;
+
+        // Reducir el agua por evaporacin
+        drop.water *= (1.0f - Params.evaporation);
+
+        // Si se ha evaporado toda el agua, terminar la simulacin
+        if (drop.water < 0.01f)
+            break;
+    }
+}
+
+void ErosionEngine::ApplyChanges()
+{
+    // Aplicar los cambios de erosin al mapa de alturas, que queda en el rango [0, 1], y
+    // marcar los tiles con algn cambio
+    for (unsigned int y = 0; y < m_Height; ++y)
+    {
+        unsigned char* dirty = m_DirtyTiles.data() + static_cast<size_t>(y / TileSize) * m_TilesX;
+        for (unsigned int tx = 0; tx < m_TilesX; ++tx)
+        {
+            size_t begin   = static_cast<size_t>(y) * m_Width + tx * TileSize;
+            size_t end     = begin + std::min(TileSize, m_Width - tx * TileSize);
+            bool   changed = false;
+            for (size_t i = begin; i < end; ++i)
+            {
+                changed      = changed || m_ChangeMap[i] != 0.0f;
+                m_Heights[i] = std::max(0.0f, std::min(1.0f, m_Heights[i] + m_ChangeMap[i]));
+            }
+            if (changed)
+                dirty[tx] = 1;
+        }
+    }
+
+    ClearChanges();
+}
+
+std::vector<HeightmapRegion> ErosionEngine::TakeDirtyRegions()
+{
+    std::vector<HeightmapRegion> regions;
+    for (unsigned int ty = 0; ty < m_TilesY; ++ty)
+    {
+        unsigned char* dirty = m_DirtyTiles.data() + static_cast<size_t>(ty) * m_TilesX;
+        for (unsigned int tx = 0; tx < m_TilesX; ++tx)
+        {
+            if (!dirty[tx])
+                continue;
+
+            // Extender la regin por los tiles modificados siguientes de la misma fila
+            unsigned int first = tx;
+            while (tx < m_TilesX && dirty[tx])
+                dirty[tx++] = 0;
+
+            HeightmapRegion region;
+            region.X      = first * TileSize;
+            region.Y      = ty * TileSize;
+            region.Width  = std::min(tx * TileSize, m_Width) - region.X;
+            region.Height = std::min((ty + 1) * TileSize, m_Height) - region.Y;
+            regions.push_back(region);
+        }
+    }
+    return regions;
+}
+
+void ErosionEngine::ClearChanges()
+{
+    std::fill(m_ChangeMap.begin(), m_ChangeMap.end(), 0.0f);
+}
+
+ErosionBenchmark ErosionEngine::Benchmark(int dropletCount, unsigned int seed)
+{
+    // Las dos corridas simulan las mismas gotas sobre el mismo terreno, as que el cambio
+    // medio por celda solo difiere por el orden de las sumas
+    ErosionBenchmark result;
+    const int        threads = NumThreads;
+    for (int run = 0; run < 2; ++run)
+    {
+        NumThreads = run == 0 ? 1 : threads;
+        ClearChanges();
+        Simulate(dropletCount, seed);
+
+        double total = 0;
+        for (float change : m_ChangeMap)
+            total += change;
+        float meanChange = m_ChangeMap.empty() ? 0.0f : static_cast<float>(total / m_ChangeMap.size());
+
+        (run == 0 ? result.SerialRate : result.ParallelRate)             = m_DropletsPerSecond;
+        (run == 0 ? result.SerialMeanChange : result.ParallelMeanChange) = meanChange;
+    }
+    NumThreads = threads;
+    ClearChanges();
+    return result;
+}
+
+bool LoadHeightmapRaw16(const std::string& path, unsigned int width, unsigned int height, std::vector<float>& heights)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    std::vector<unsigned char> bytes(static_cast<size_t>(width) * height * 2);
+    if (!file.read(reinterpret_cast<char*>(bytes.data()), bytes.size()))
+        return false;
+
+    heights.resize(static_cast<size_t>(width) * height);
+    for (size_t i = 0; i < heights.size(); ++i)
+        heights[i] = static_cast<float>(bytes[2 * i] | bytes[2 * i + 1] << 8) / 65535.0f;
+    return true;
+}
+
+bool SaveHeightmapRaw16(const std::string& path, unsigned int width, unsigned int height, const std::vector<float>& heights)
+{
+    std::vector<unsigned char> bytes(static_cast<size_t>(width) * height * 2);
+    for (size_t i = 0; i < bytes.size() / 2; ++i)
+    {
+        auto value       = static_cast<unsigned int>(std::max(0.0f, std::min(1.0f, heights[i])) * 65535.0f + 0.5f);
+        bytes[2 * i]     = static_cast<unsigned char>(value & 0xFF);
+        bytes[2 * i + 1] = static_cast<unsigned char>(value >> 8);
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    return file && file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+bool LoadHeightmapPGM(const std::string& path, unsigned int& width, unsigned int& height, std::vector<float>& heights)
+{
+    // PGM binario (P5): cabecera de texto con comentarios que empiezan por '#', y valores de
+    // 8 bits, o de 16 bits en big endian si el mximo pasa de 255
+    std::ifstream file(path, std::ios::binary);
+    std::string   magic;
+    unsigned int  maxValue   = 0;
+    auto          readNumber = [&file](unsigned int& value) {
+        file >> std::ws;
+        while (file.peek() == '#')
+        {
+            file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            file >> std::ws;
+        }
+        return static_cast<bool>(file >> value);
+    };
+    if (!(file >> magic) || magic != "P5" || !readNumber(width) || !readNumber(height) || !readNumber(maxValue))
+        return false;
+    if (width == 0 || height == 0 || maxValue == 0 || maxValue > 65535)
+        return false;
+    file.get(); // Un solo espacio separa la cabecera de los valores
+
+    const size_t               bytesPerValue = maxValue > 255 ? 2 : 1;
+    std::vector<unsigned char> bytes(static_cast<size_t>(width) * height * bytesPerValue);
+    if (!file.read(reinterpret_cast<char*>(bytes.data()), bytes.size()))
+        return false;
+
+    heights.resize(static_cast<size_t>(width) * height);
+    for (size_t i = 0; i < heights.size(); ++i)
+    {
+        unsigned int value = bytesPerValue == 2 ? bytes[2 * i] << 8 | bytes[2 * i + 1] : bytes[i];
+        heights[i]         = static_cast<float>(std::min(value, maxValue)) / maxValue;
+    }
+    return true;
+}
+
+bool SaveHeightmapPGM(const std::string& path, unsigned int width, unsigned int height, const std::vector<float>& heights)
+{
+    // PGM binario de 16 bits: los valores van en big endian
+    std::vector<unsigned char> bytes(static_cast<size_t>(width) * height * 2);
+    for (size_t i = 0; i < bytes.size() / 2; ++i)
+    {
+        auto value       = static_cast<unsigned int>(std::max(0.0f, std::min(1.0f, heights[i])) * 65535.0f + 0.5f);
+        bytes[2 * i]     = static_cast<unsigned char>(value >> 8);
+        bytes[2 * i + 1] = static_cast<unsigned char>(value & 0xFF);
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    file << "P5\n"
+         << width << ' ' << height << "\n65535\n";
+    return file && file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+} // namespace Diligent
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Simulacin de erosin hidrulica por gotas sobre un mapa de alturas en CPU. No depende de
+// Diligent ni de un dispositivo grfico: la usan el tutorial y la herramienta ErosionCLI.
+
+namespace Diligent
+{
+
+// Estructura para el manejo de una gota de agua en la simulacin de erosin
+struct Droplet
+{
+    float x, y;       // Posicin en el mapa, en celdas
+    float dirX, dirY; // Direccin normalizada de movimiento
+    float speed;      // Velocidad actual
+    float water;      // Cantidad de agua
+    float sediment;   // Cantidad de sedimento transportado
+};
+
+// Parmetros para la simulacin de erosin
+struct ErosionParams
+{
+    float inertia      = 0.3f;  // Persistencia de la direccin (0-1)
+    float capacity     = 8.0f;  // Capacidad de sedimento
+    float deposition   = 0.2f;  // Velocidad de deposicin (0-1)
+    float erosion      = 0.7f;  // Velocidad de erosin (0-1)
+    float evaporation  = 0.02f; // Tasa de evaporacin (0-1)
+    float minSlope     = 0.01f; // Pendiente mnima para la erosin
+    float gravity      = 10.0f; // Fuerza de gravedad
+    float radius       = 4.0f;  // Radio de erosin
+    int   maxPath      = 64;    // Pasos mximos por gota
+    int   dropletCount = 10000; // Nmero de gotas por ronda
+};
+
+// Pesos del pincel gaussiano de erosin precalculados para un radio. La posicin de la gota
+// dentro de su celda se redondea a 1/SubSteps de celda, y para cada posicin posible hay un
+// kernel de Size x Size pesos, cero fuera del crculo.
+struct ErosionBrush
+{
+    static constexpr int SubSteps = 8;
+
+    float              Radius = 0; // Radio con el que se construy
+    int                R      = 0; // Celdas a cada lado del centro
+    int                Size   = 0; // 2 * R + 1
+    std::vector<float> Weights;    // (SubSteps + 1)^2 kernels de Size * Size
+
+    void         Build(float radius);
+    const float* Kernel(float fx, float fy) const;
+};
+
+// Rectngulo del mapa de alturas, en celdas
+struct HeightmapRegion
+{
+    unsigned int X      = 0;
+    unsigned int Y      = 0;
+    unsigned int Width  = 0;
+    unsigned int Height = 0;
+};
+
+// Resultado de ErosionEngine::Benchmark
+struct ErosionBenchmark
+{
+    float SerialRate         = 0; // Gotas/s con un hilo
+    float ParallelRate       = 0; // Gotas/s con NumThreads hilos
+    float SerialMeanChange   = 0; // Cambio medio por celda de cada corrida
+    float ParallelMeanChange = 0;
+};
+
+// Mapa de alturas en [0, 1] con la simulacin de gotas. Simulate() acumula los cambios de
+// una ronda en un mapa aparte, repartiendo las gotas entre NumThreads hilos, cada uno con su
+// propio mapa de cambios; ApplyChanges() los suma a las alturas.
+//
+// El mapa se divide en tiles de TileSize x TileSize celdas. ApplyChanges() y SetHeightmap()
+// marcan los tiles cuyas alturas cambian, y TakeDirtyRegions() los entrega para que solo esa
+// parte se vuelva a subir a la GPU.
+class ErosionEngine
+{
+public:
+    static constexpr unsigned int TileSize = 64;
+
+    ErosionParams Params;
+    int           NumThreads = 1; // Hilos para la simulacin; el constructor usa todos los ncleos
+
+    ErosionEngine();
+
+    void SetHeightmap(std::vector<float> heights, unsigned int width, unsigned int height);
+
+    // Copia de heights, del mismo tamao que el mapa, solo los tiles indicados (ty * tilesX + tx)
+    // y los marca como modificados
+    void SetTiles(const std::vector<float>& heights, const std::vector<unsigned int>& tiles);
+
+    // Copia un rectngulo de alturas (width x height, filas de stride valores) en (x, y) y marca
+    // como modificados los tiles que toca
+    void SetRegion(unsigned int x, unsigned int y, unsigned int width, unsigned int height, const float* heights, size_t stride);
+
+    unsigned int              GetWidth() const { return m_Width; }
+    unsigned int              GetHeight() const { return m_Height; }
+    const std::vector<float>& GetHeights() const { return m_Heights; }
+
+    // Una ronda de dropletCount gotas. Cada gota toma su secuencia aleatoria de la semilla y
+    // de su nmero: con la misma semilla y los mismos hilos el resultado se repite, y con
+    // otro nmero de hilos solo cambia el redondeo de la suma de los mapas de cambios.
+    void Simulate(int dropletCount, unsigned int seed);
+    void ApplyChanges();
+    void ClearChanges();
+
+    // Suma al mapa de cambios la diferencia entre heights * scale y las alturas actuales, para
+    // los solvers que calculan directamente el terreno nuevo (PipeErosion)
+    void AccumulateChanges(const std::vector<float>& heights, float scale);
+
+    // Tiles modificados desde la llamada anterior, juntando los tiles contiguos de cada fila
+    // de tiles en una sola regin, y los marca como limpios
+    std::vector<HeightmapRegion> TakeDirtyRegions();
+
+    // Mide gotas/s de una ronda con un hilo y con NumThreads hilos, sin aplicar los cambios
+    ErosionBenchmark Benchmark(int dropletCount, unsigned int seed);
+
+    float GetLastSeconds() const { return m_LastSeconds; }
+    float GetDropletsPerSecond() const { return m_DropletsPerSecond; }
+
+    float SampleHeight(float x, float y) const;
+
+private:
+    void SimulateDroplet(unsigned int seed, int droplet, std::vector<float>& changeMap) const;
+    void ModifyHeights(std::vector<float>& changeMap, float x, float y, float delta, const ErosionBrush& brush) const;
+
+    unsigned int                    m_Width  = 0;
+    unsigned int                    m_Height = 0;
+    std::vector<float>              m_Heights;          // Alturas actuales
+    std::vector<float>              m_ChangeMap;        // Cambios acumulados por Simulate
+    std::vector<std::vector<float>> m_ThreadChangeMaps; // Mapa de cambios de cada hilo
+    std::vector<unsigned char>      m_DirtyTiles;       // Tiles modificados, fila por fila
+    unsigned int                    m_TilesX = 0;       // Tiles por fila
+    unsigned int                    m_TilesY = 0;       // Filas de tiles
+    ErosionBrush                    m_DepositBrush;     // Pincel de radio 1 para depositar
+    ErosionBrush                    m_ErosionBrush;     // Pincel de radio Params.radius
+
+    float m_LastSeconds       = 0; // Duracin de la ltima ronda
+    float m_DropletsPerSecond = 0; // Gotas por segundo de la ltima ronda
+};
+
+// Mapas de alturas de 16 bits sin cabecera (little endian, fila por fila), el formato de
+// intercambio habitual de las herramientas de terreno, y PGM de 16 bits para verlos. Al leer
+// un PGM se aceptan 8 o 16 bits y el tamao sale de la cabecera.
+bool LoadHeightmapRaw16(const std::string& path, unsigned int width, unsigned int height, std::vector<float>& heights);
+bool SaveHeightmapRaw16(const std::string& path, unsigned int width, unsigned int height, const std::vector<float>& heights);
+bool LoadHeightmapPGM(const std::string& path, unsigned int& width, unsigned int& height, std::vector<float>& heights);
+bool SaveHeightmapPGM(const std::string& path, unsigned int width, unsigned int height, const std::vector<float>& heights);
+
+} // namespace Diligent
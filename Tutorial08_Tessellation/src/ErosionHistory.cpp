@@ -0,0 +1,172 @@
+#include "ErosionHistory.hpp"
+#include "ErosionEngine.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace Diligent
+{
+
+namespace
+{
+
+std::uint32_t FloatBits(float value)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float BitsFloat(std::uint32_t bits)
+{
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Bytes que se guardan de una celda segn su cdigo de 2 bits
+constexpr int CodeBytes[4] = {0, 2, 3, 4};
+
+} // namespace
+
+void ErosionHistory::Reset(const ErosionEngine& engine)
+{
+    m_Width   = engine.GetWidth();
+    m_Height  = engine.GetHeight();
+    m_TilesX  = (m_Width + ErosionEngine::TileSize - 1) / ErosionEngine::TileSize;
+    m_TilesY  = (m_Height + ErosionEngine::TileSize - 1) / ErosionEngine::TileSize;
+    m_Current = engine.GetHeights();
+
+    m_Deltas.clear();
+    m_OldestStep = 0;
+    m_Step       = 0;
+    m_DeltaBytes = 0;
+}
+
+void ErosionHistory::Push(const ErosionEngine& engine)
+{
+    // Descartar los pasos que se podan rehacer
+    while (GetNewestStep() > m_Step)
+    {
+        m_DeltaBytes -= m_Deltas.back().Bytes();
+        m_Deltas.pop_back();
+    }
+
+    const auto& heights = engine.GetHeights();
+    const auto  T       = ErosionEngine::TileSize;
+
+    Delta delta;
+    for (unsigned int ty = 0; ty < m_TilesY; ++ty)
+    {
+        for (unsigned int tx = 0; tx < m_TilesX; ++tx)
+        {
+            const unsigned int x0 = tx * T, x1 = std::min(x0 + T, m_Width);
+            const unsigned int y0 = ty * T, y1 = std::min(y0 + T, m_Height);
+
+            // Saltar los tiles sin cambios
+            bool changed = false;
+            for (unsigned int y = y0; y < y1 && !changed; ++y)
+            {
+                size_t row = static_cast<size_t>(y) * m_Width;
+                changed    = std::memcmp(&heights[row + x0], &m_Current[row + x0], (x1 - x0) * sizeof(float)) != 0;
+            }
+            if (!changed)
+                continue;
+
+            delta.Tiles.push_back(ty * m_TilesX + tx);
+            delta.Offsets.push_back(delta.Data.size());
+
+            // Grupos de 4 celdas: un byte con sus 4 cdigos seguido de sus bytes bajos
+            size_t header = 0;
+            int    cell   = 0;
+            for (unsigned int y = y0; y < y1; ++y)
+            {
+                for (unsigned int x = x0; x < x1; ++x, ++cell)
+                {
+                    size_t        i    = static_cast<size_t>(y) * m_Width + x;
+                    std::uint32_t bits = FloatBits(heights[i]) ^ FloatBits(m_Current[i]);
+                    int           code = bits == 0 ? 0 : bits <= 0xFFFF ? 1 : bits <= 0xFFFFFF ? 2 : 3;
+
+                    if (cell % 4 == 0)
+                    {
+                        header = delta.Data.size();
+                        delta.Data.push_back(0);
+                    }
+                    delta.Data[header] |= static_cast<std::uint8_t>(code << (2 * (cell % 4)));
+                    for (int b = 0; b < CodeBytes[code]; ++b)
+                        delta.Data.push_back(static_cast<std::uint8_t>(bits >> (8 * b)));
+
+                    m_Current[i] = heights[i];
+                }
+            }
+        }
+    }
+
+    m_DeltaBytes += delta.Bytes();
+    m_Deltas.push_back(std::move(delta));
+    ++m_Step;
+
+    // Respetar el lmite de memoria descartando los pasos ms antiguos
+    while (m_DeltaBytes > MemoryLimit && !m_Deltas.empty())
+    {
+        m_DeltaBytes -= m_Deltas.front().Bytes();
+        m_Deltas.pop_front();
+        ++m_OldestStep;
+    }
+}
+
+void ErosionHistory::ApplyDelta(const Delta& delta)
+{
+    const auto T = ErosionEngine::TileSize;
+    for (size_t t = 0; t < delta.Tiles.size(); ++t)
+    {
+        const unsigned int tx = delta.Tiles[t] % m_TilesX, ty = delta.Tiles[t] / m_TilesX;
+        const unsigned int x0 = tx * T, x1 = std::min(x0 + T, m_Width);
+        const unsigned int y0 = ty * T, y1 = std::min(y0 + T, m_Height);
+
+        const std::uint8_t* data  = delta.Data.data() + delta.Offsets[t];
+        std::uint8_t        codes = 0;
+        int                 cell  = 0;
+        for (unsigned int y = y0; y < y1; ++y)
+        {
+            for (unsigned int x = x0; x < x1; ++x, ++cell)
+            {
+                if (cell % 4 == 0)
+                    codes = *data++;
+
+                int           code = (codes >> (2 * (cell % 4))) & 3;
+                std::uint32_t bits = 0;
+                for (int b = 0; b < CodeBytes[code]; ++b)
+                    bits |= static_cast<std::uint32_t>(*data++) << (8 * b);
+
+                size_t i     = static_cast<size_t>(y) * m_Width + x;
+                m_Current[i] = BitsFloat(FloatBits(m_Current[i]) ^ bits);
+            }
+        }
+    }
+}
+
+bool ErosionHistory::GoTo(int step, ErosionEngine& engine)
+{
+    if (step < GetOldestStep() || step > GetNewestStep() || step == m_Step)
+        return false;
+
+    // Recorrer los deltas entre los dos pasos, anotando los tiles que cambian
+    std::vector<unsigned char> touched(static_cast<size_t>(m_TilesX) * m_TilesY, 0);
+    while (m_Step != step)
+    {
+        const Delta& delta = m_Deltas[(step < m_Step ? m_Step - 1 : m_Step) - m_OldestStep];
+        ApplyDelta(delta);
+        for (unsigned int tile : delta.Tiles)
+            touched[tile] = 1;
+        m_Step += step < m_Step ? -1 : 1;
+    }
+
+    std::vector<unsigned int> tiles;
+    for (unsigned int tile = 0; tile < touched.size(); ++tile)
+        if (touched[tile])
+            tiles.push_back(tile);
+    engine.SetTiles(m_Current, tiles);
+    return true;
+}
+
+} // namespace Diligent
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace Diligent
+{
+
+class ErosionEngine;
+
+// Historial de deshacer/rehacer de un ErosionEngine. Cada paso guarda solo los tiles del mapa
+// que cambiaron (ErosionEngine::TileSize), como el XOR de los bits de las alturas anteriores y
+// nuevas. El XOR de dos alturas parecidas tiene ceros en los bytes altos, as que cada celda se
+// guarda con 0, 2, 3 o 4 bytes segn su valor, con un cdigo de 2 bits. El mismo delta sirve
+// para deshacer y rehacer el paso, y el historial solo mantiene una copia completa del mapa:
+// el estado actual. Cuando los deltas pasan de MemoryLimit se descartan los pasos ms antiguos.
+class ErosionHistory
+{
+public:
+    size_t MemoryLimit = size_t{256} << 20; // Bytes de deltas como mximo
+
+    // Empieza un historial nuevo con el estado actual del motor como paso 0
+    void Reset(const ErosionEngine& engine);
+
+    // Registra como paso nuevo el estado actual del motor, descartando los pasos que se
+    // podan rehacer
+    void Push(const ErosionEngine& engine);
+
+    // Lleva el motor al paso indicado, entre GetOldestStep() y GetNewestStep(). Solo se
+    // reemplazan los tiles que cambian, que quedan marcados para subirse a la GPU.
+    bool GoTo(int step, ErosionEngine& engine);
+    bool Undo(ErosionEngine& engine) { return GoTo(m_Step - 1, engine); }
+    bool Redo(ErosionEngine& engine) { return GoTo(m_Step + 1, engine); }
+
+    int    GetStep() const { return m_Step; }
+    int    GetOldestStep() const { return m_OldestStep; }
+    int    GetNewestStep() const { return m_OldestStep + static_cast<int>(m_Deltas.size()); }
+    size_t GetMemoryUsage() const { return m_DeltaBytes; }
+
+private:
+    // Cambios de un paso al siguiente
+    struct Delta
+    {
+        std::vector<unsigned int> Tiles;   // Tiles modificados (ty * tilesX + tx)
+        std::vector<size_t>       Offsets; // Inicio de cada tile en Data
+        std::vector<std::uint8_t> Data;    // Cdigos y bytes de cada tile
+
+        size_t Bytes() const { return Tiles.size() * (sizeof(unsigned int) + sizeof(size_t)) + Data.size(); }
+    };
+
+    void ApplyDelta(const Delta& delta);
+
+    unsigned int       m_Width  = 0;
+    unsigned int       m_Height = 0;
+    unsigned int       m_TilesX = 0;
+    unsigned int       m_TilesY = 0;
+    std::vector<float> m_Current; // Alturas del paso m_Step
+
+    std::deque<Delta> m_Deltas;         // m_Deltas[i] lleva del paso m_OldestStep + i al siguiente
+    int               m_OldestStep = 0; // Paso ms antiguo que se puede recuperar
+    int               m_Step       = 0; // Paso actual
+    size_t            m_DeltaBytes = 0; // Memoria de todos los deltas
+};
+
+} // namespace Diligent
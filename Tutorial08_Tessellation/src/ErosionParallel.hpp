@@ -0,0 +1,26 @@
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace Diligent
+{
+
+// Divide [0, count) en numThreads bloques contiguos y llama a body(inicio, fin) para cada
+// uno en su propio hilo; el ltimo bloque corre en el hilo que llama
+template <typename BodyType>
+void ParallelFor(int count, int numThreads, BodyType&& body)
+{
+    numThreads = std::max(1, std::min(numThreads, count));
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads - 1; ++t)
+        threads.emplace_back(body, count * t / numThreads, count * (t + 1) / numThreads);
+    body(count * (numThreads - 1) / numThreads, count);
+
+    for (auto& thread : threads)
+        thread.join();
+}
+
+} // namespace Diligent
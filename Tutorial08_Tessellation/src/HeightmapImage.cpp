@@ -0,0 +1,142 @@
+#include "HeightmapImage.hpp"
+#include "ErosionEngine.hpp"
+#if HEIGHTMAP_IMAGE_TEXTURE_LOADER
+#    include "Image.h"
+#    include "RefCntAutoPtr.hpp"
+#endif
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace Diligent
+{
+
+namespace
+{
+
+bool EndsWith(const std::string& str, const std::string& suffix)
+{
+    return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool ReadSidecar(const std::string& path, std::vector<float>& heights, unsigned int& width, unsigned int& height)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::uint8_t  header[8];
+    if (!file || !file.read(reinterpret_cast<char*>(header), sizeof(header)))
+        return false;
+
+    width  = header[0] | header[1] << 8 | header[2] << 16 | static_cast<std::uint32_t>(header[3]) << 24;
+    height = header[4] | header[5] << 8 | header[6] << 16 | static_cast<std::uint32_t>(header[7]) << 24;
+
+    // Un archivo truncado o de otro formato no coincide con el tamao de la cabecera
+    std::error_code ec;
+    if (std::filesystem::file_size(path, ec) != sizeof(header) + static_cast<std::uintmax_t>(width) * height * 2 || ec)
+        return false;
+
+    std::vector<std::uint8_t> bytes(static_cast<size_t>(width) * height * 2);
+    if (!file.read(reinterpret_cast<char*>(bytes.data()), bytes.size()))
+        return false;
+
+    heights.resize(static_cast<size_t>(width) * height);
+    for (size_t i = 0; i < heights.size(); ++i)
+        heights[i] = static_cast<float>(bytes[2 * i] | bytes[2 * i + 1] << 8) / 65535.0f;
+    return true;
+}
+
+bool WriteSidecar(const std::string& path, const std::vector<float>& heights, unsigned int width, unsigned int height)
+{
+    std::vector<std::uint8_t> bytes(8 + heights.size() * 2);
+    for (int i = 0; i < 4; ++i)
+    {
+        bytes[i]     = static_cast<std::uint8_t>(width >> (8 * i));
+        bytes[4 + i] = static_cast<std::uint8_t>(height >> (8 * i));
+    }
+    for (size_t i = 0; i < heights.size(); ++i)
+    {
+        auto value           = static_cast<std::uint32_t>(std::max(0.0f, std::min(1.0f, heights[i])) * 65535.0f + 0.5f);
+        bytes[8 + 2 * i]     = static_cast<std::uint8_t>(value & 0xFF);
+        bytes[8 + 2 * i + 1] = static_cast<std::uint8_t>(value >> 8);
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    return file && file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+} // namespace
+
+bool LoadHeightmapImage(const char* path, std::vector<float>& heights, unsigned int& width, unsigned int& height)
+{
+    if (EndsWith(path, ".pgm"))
+        return LoadHeightmapPGM(path, width, height, heights);
+    if (EndsWith(path, ".h16"))
+        return ReadSidecar(path, heights, width, height);
+
+#if HEIGHTMAP_IMAGE_TEXTURE_LOADER
+    RefCntAutoPtr<Image> pImage;
+    CreateImageFromFile(path, &pImage);
+    if (!pImage)
+        return false;
+
+    const ImageDesc& Desc   = pImage->GetDesc();
+    const Uint8*     pBytes = pImage->GetData()->GetConstDataPtr<Uint8>();
+
+    width  = Desc.Width;
+    height = Desc.Height;
+    heights.resize(static_cast<size_t>(width) * height);
+
+    for (Uint32 y = 0; y < Desc.Height; ++y)
+    {
+        const Uint8* pRow = pBytes + static_cast<size_t>(y) * Desc.RowStride;
+        float*       pDst = heights.data() + static_cast<size_t>(y) * width;
+        switch (Desc.ComponentType)
+        {
+            case VT_UINT8:
+                for (Uint32 x = 0; x < Desc.Width; ++x)
+                    pDst[x] = static_cast<float>(pRow[x * Desc.NumComponents]) / 255.0f;
+                break;
+
+            case VT_UINT16:
+            {
+                const Uint16* pRow16 = reinterpret_cast<const Uint16*>(pRow);
+                for (Uint32 x = 0; x < Desc.Width; ++x)
+                    pDst[x] = static_cast<float>(pRow16[x * Desc.NumComponents]) / 65535.0f;
+                break;
+            }
+
+            default:
+                return false;
+        }
+    }
+    return true;
+#else
+    // Sin el TextureLoader solo se leen PGM
+    return false;
+#endif
+}
+
+bool LoadHeightmapImageCached(const char* path, std::vector<float>& heights, unsigned int& width, unsigned int& height)
+{
+    namespace fs = std::filesystem;
+
+    // No es ".r16": las herramientas de terreno, como ErosionCLI, leen esos archivos como RAW sin cabecera
+    const std::string sidecar = std::string{path} + ".h16";
+
+    // Usar el archivo de alturas si existe y no es ms antiguo que la imagen
+    std::error_code ec, sidecarEc;
+    auto            imageTime   = fs::last_write_time(path, ec);
+    auto            sidecarTime = fs::last_write_time(sidecar, sidecarEc);
+    if (!ec && !sidecarEc && sidecarTime >= imageTime && ReadSidecar(sidecar, heights, width, height))
+        return true;
+
+    if (!LoadHeightmapImage(path, heights, width, height))
+        return false;
+
+    // Si no se puede escribir junto a la imagen, la prxima vez se vuelve a decodificar
+    WriteSidecar(sidecar, heights, width, height);
+    return true;
+}
+
+} // namespace Diligent
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vector>
+
+namespace Diligent
+{
+
+// Decodifica una imagen (PNG, JPEG, TGA...) con el TextureLoader de Diligent, solo en CPU y
+// sin dispositivo grfico, y toma su primer canal como altura en [0, 1]. Los PGM y los .h16
+// de LoadHeightmapImageCached se leen sin el TextureLoader; si se compila sin l
+// (HEIGHTMAP_IMAGE_TEXTURE_LOADER a 0) son los nicos formatos que se aceptan.
+bool LoadHeightmapImage(const char* path, std::vector<float>& heights, unsigned int& width, unsigned int& height);
+
+// Igual que LoadHeightmapImage, pero guarda las alturas decodificadas junto a la imagen, en
+// path + ".h16" (ancho y alto de 32 bits y alturas de 16 bits, little endian), y mientras ese
+// archivo sea ms reciente que la imagen las lee de ah sin decodificarla. LoadHeightmapImage
+// tambin lee los archivos .h16.
+bool LoadHeightmapImageCached(const char* path, std::vector<float>& heights, unsigned int& width, unsigned int& height);
+
+} // namespace Diligent
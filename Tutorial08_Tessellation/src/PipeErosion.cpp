@@ -0,0 +1,298 @@
+#include "PipeErosion.hpp"
+#include "ErosionEngine.hpp"
+#include "ErosionParallel.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace Diligent
+{
+
+namespace
+{
+
+struct PipeStepConstants
+{
+    float dt;
+    float accel;
+    float Kc;
+    float Ks;
+    float Kd;
+    float minTilt;
+    float invDepth;
+};
+
+// Las pasadas recorren las celdas [x0, x1) de una fila. Los punteros apuntan al inicio de la
+// fila y no se solapan (__restrict), y el cuerpo del bucle no tiene saltos que dependan de los
+// datos: as el compilador puede vectorizarlo. dl y dr son los desplazamientos de las vecinas
+// izquierda y derecha, up y dn los de las vecinas de arriba y abajo (0 en los bordes).
+
+void UpdateFlux(const PipeStepConstants& c,
+                const float* __restrict b,
+                const float* __restrict d,
+                int                     up,
+                int                     dn,
+                int                     dl,
+                int                     dr,
+                float                   mL,
+                float                   mR,
+                float                   mT,
+                float                   mB,
+                float* __restrict fL,
+                float* __restrict fR,
+                float* __restrict fT,
+                float* __restrict fB,
+                int               x0,
+                int               x1)
+{
+    for (int x = x0; x < x1; ++x)
+    {
+        float h   = b[x] + d[x];
+        float l   = std::max(0.0f, fL[x] + c.accel * (h - b[x + dl] - d[x + dl])) * mL;
+        float r   = std::max(0.0f, fR[x] + c.accel * (h - b[x + dr] - d[x + dr])) * mR;
+        float t   = std::max(0.0f, fT[x] + c.accel * (h - b[x + up] - d[x + up])) * mT;
+        float bo  = std::max(0.0f, fB[x] + c.accel * (h - b[x + dn] - d[x + dn])) * mB;
+        float sum = (l + r + t + bo) * c.dt;
+        // min(1, d / sum) sin salto despus de la divisin: vale 1 cuando sum <= d
+        float k = d[x] / (std::max(sum, d[x]) + 1e-30f);
+        fL[x]   = l * k;
+        fR[x]   = r * k;
+        fT[x]   = t * k;
+        fB[x]   = bo * k;
+    }
+}
+
+void UpdateWater(const PipeStepConstants& c,
+                 const float* __restrict fL,
+                 const float* __restrict fR,
+                 const float* __restrict fT,
+                 const float* __restrict fB,
+                 const float* __restrict inT,
+                 const float* __restrict inB,
+                 int                     dl,
+                 int                     dr,
+                 float                   mL,
+                 float                   mR,
+                 float                   mT,
+                 float                   mB,
+                 float* __restrict d,
+                 float* __restrict u,
+                 float* __restrict v,
+                 int               x0,
+                 int               x1)
+{
+    for (int x = x0; x < x1; ++x)
+    {
+        float fromL = fR[x + dl] * mL;
+        float fromR = fL[x + dr] * mR;
+        float fromT = inT[x] * mT;
+        float fromB = inB[x] * mB;
+        float dOld  = d[x];
+        float dNew  = std::max(0.0f, dOld + c.dt * (fromL + fromR + fromT + fromB - fL[x] - fR[x] - fT[x] - fB[x]));
+        // Velocidad = flujo medio / profundidad media; el trmino fijo la limita con muy poca agua
+        float inv   = 1.0f / (dOld + dNew + 2e-3f);
+        u[x]        = (fromL - fL[x] + fR[x] - fromR) * inv;
+        v[x]        = (fromT - fT[x] + fB[x] - fromB) * inv;
+        d[x]        = dNew;
+    }
+}
+
+void ErodeDeposit(const PipeStepConstants& c,
+                  const float* __restrict b,
+                  int                     up,
+                  int                     dn,
+                  int                     dl,
+                  int                     dr,
+                  float                   ix,
+                  float                   iy,
+                  const float* __restrict d,
+                  const float* __restrict u,
+                  const float* __restrict v,
+                  float* __restrict s,
+                  float* __restrict nb,
+                  int               x0,
+                  int               x1)
+{
+    for (int x = x0; x < x1; ++x)
+    {
+        float gx     = (b[x + dr] - b[x + dl]) * ix;
+        float gy     = (b[x + dn] - b[x + up]) * iy;
+        float g2     = gx * gx + gy * gy;
+        float sinA   = std::max(c.minTilt, std::sqrt(g2 / (1.0f + g2)));
+        float speed  = std::sqrt(u[x] * u[x] + v[x] * v[x]);
+        float depth  = std::min(d[x] * c.invDepth, 1.0f); // Con poca agua no se arrastra tanto
+        float diff   = c.Kc * sinA * speed * depth - s[x];
+        float amount = diff * (diff > 0.0f ? c.Ks : c.Kd); // Negativo: deposita
+        nb[x]        = b[x] - amount;
+        s[x] += amount;
+    }
+}
+
+} // namespace
+
+void PipeErosion::Reset()
+{
+    m_Width  = 0;
+    m_Height = 0;
+}
+
+void PipeErosion::Resize(unsigned int width, unsigned int height)
+{
+    const size_t size = static_cast<size_t>(width) * height;
+
+    m_Width  = width;
+    m_Height = height;
+    m_Terrain.assign(size, 0.0f);
+    m_NewTerrain.assign(size, 0.0f);
+    m_Water.assign(size, 0.0f);
+    m_FluxL.assign(size, 0.0f);
+    m_FluxR.assign(size, 0.0f);
+    m_FluxT.assign(size, 0.0f);
+    m_FluxB.assign(size, 0.0f);
+    m_VelocityX.assign(size, 0.0f);
+    m_VelocityY.assign(size, 0.0f);
+    m_Sediment.assign(size, 0.0f);
+    m_NewSediment.assign(size, 0.0f);
+}
+
+void PipeErosion::Run(ErosionEngine& engine)
+{
+    const auto start      = std::chrono::high_resolution_clock::now();
+    const int  numThreads = std::max(1, engine.NumThreads);
+
+    if (m_Width != engine.GetWidth() || m_Height != engine.GetHeight())
+        Resize(engine.GetWidth(), engine.GetHeight());
+
+    // Tomar el terreno actual del motor, que puede haber cambiado desde la ltima iteracin
+    const auto& heights = engine.GetHeights();
+    const float scale   = Params.heightScale;
+    ParallelFor(static_cast<int>(m_Height), numThreads, [&](int firstRow, int lastRow) {
+        for (size_t i = static_cast<size_t>(firstRow) * m_Width; i < static_cast<size_t>(lastRow) * m_Width; ++i)
+            m_Terrain[i] = heights[i] * scale;
+    });
+
+    for (int step = 0; step < Params.stepsPerIteration; ++step)
+        Step(numThreads);
+
+    engine.AccumulateChanges(m_Terrain, 1.0f / scale);
+
+    double water = 0;
+    for (float depth : m_Water)
+        water += depth;
+    m_TotalWater = static_cast<float>(water);
+
+    m_LastSeconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void PipeErosion::Step(int numThreads)
+{
+    const int W = static_cast<int>(m_Width);
+    const int H = static_cast<int>(m_Height);
+
+    PipeStepConstants c;
+    c.dt       = Params.timeStep;
+    c.accel    = Params.timeStep * Params.gravity;
+    c.Kc       = Params.capacity;
+    c.Ks       = Params.dissolving;
+    c.Kd       = Params.deposition;
+    c.minTilt  = Params.minTilt;
+    c.invDepth = 1.0f / Params.erosionDepth;
+
+    // Cada fila se procesa en tres tramos: la columna izquierda, el interior y la columna
+    // derecha. En los bordes la vecina de fuera es la propia celda (desplazamiento 0) y su
+    // flujo se anula con la mscara, as que el mismo bucle sirve para las tres.
+    auto forEachSpan = [W](auto&& span) {
+        if (W == 1)
+            return span(0, 1, 0, 0, 0.0f, 0.0f);
+        span(0, 1, 0, 1, 0.0f, 1.0f);
+        span(1, W - 1, -1, 1, 1.0f, 1.0f);
+        span(W - 1, W, -1, 0, 1.0f, 0.0f);
+    };
+
+    // 1. Flujo de salida hacia cada vecina segn la diferencia de nivel del agua, escalado
+    //    para no sacar ms agua de la que hay en la celda
+    ParallelFor(H, numThreads, [&](int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; ++y)
+        {
+            const size_t row = static_cast<size_t>(y) * W;
+            const int    up  = y > 0 ? -W : 0;
+            const int    dn  = y < H - 1 ? W : 0;
+            forEachSpan([&](int x0, int x1, int dl, int dr, float mL, float mR) {
+                UpdateFlux(c, &m_Terrain[row], &m_Water[row], up, dn, dl, dr, mL, mR, y > 0 ? 1.0f : 0.0f, y < H - 1 ? 1.0f : 0.0f,
+                           &m_FluxL[row], &m_FluxR[row], &m_FluxT[row], &m_FluxB[row], x0, x1);
+            });
+        }
+    });
+
+    // 2. Nueva profundidad del agua con el flujo de entrada y de salida, y velocidad a partir
+    //    del flujo medio que atraviesa la celda
+    ParallelFor(H, numThreads, [&](int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; ++y)
+        {
+            const size_t row = static_cast<size_t>(y) * W;
+            // Flujo hacia esta fila desde la fila de arriba y desde la de abajo
+            const float* inT = y > 0 ? &m_FluxB[row - W] : &m_FluxB[row];
+            const float* inB = y < H - 1 ? &m_FluxT[row + W] : &m_FluxT[row];
+            forEachSpan([&](int x0, int x1, int dl, int dr, float mL, float mR) {
+                UpdateWater(c, &m_FluxL[row], &m_FluxR[row], &m_FluxT[row], &m_FluxB[row], inT, inB, dl, dr, mL, mR,
+                            y > 0 ? 1.0f : 0.0f, y < H - 1 ? 1.0f : 0.0f, &m_Water[row], &m_VelocityX[row], &m_VelocityY[row], x0, x1);
+            });
+        }
+    });
+
+    // 3. Erosin y deposicin segn la capacidad de transporte, que crece con la pendiente,
+    //    la velocidad y la profundidad del agua
+    ParallelFor(H, numThreads, [&](int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; ++y)
+        {
+            const size_t row = static_cast<size_t>(y) * W;
+            const int    up  = y > 0 ? -W : 0;
+            const int    dn  = y < H - 1 ? W : 0;
+            const float  iy  = up != 0 && dn != 0 ? 0.5f : 1.0f;
+            forEachSpan([&](int x0, int x1, int dl, int dr, float, float) {
+                const float ix = dl != 0 && dr != 0 ? 0.5f : 1.0f;
+                ErodeDeposit(c, &m_Terrain[row], up, dn, dl, dr, ix, iy, &m_Water[row], &m_VelocityX[row], &m_VelocityY[row],
+                             &m_Sediment[row], &m_NewTerrain[row], x0, x1);
+            });
+        }
+    });
+    std::swap(m_Terrain, m_NewTerrain);
+
+    // 4. Transporte del sedimento con la velocidad (semilagrangiano), evaporacin y lluvia.
+    //    La lectura bilineal del sedimento es dispersa; el resto de la fila es lineal.
+    const float keep = 1.0f - Params.evaporation * c.dt;
+    const float rain = Params.rain * c.dt;
+    ParallelFor(H, numThreads, [&](int firstRow, int lastRow) {
+        const float maxX = static_cast<float>(W - 1);
+        const float maxY = static_cast<float>(H - 1);
+        for (int y = firstRow; y < lastRow; ++y)
+        {
+            const size_t row = static_cast<size_t>(y) * W;
+            const float* u   = &m_VelocityX[row];
+            const float* v   = &m_VelocityY[row];
+            float*       ns  = &m_NewSediment[row];
+            for (int x = 0; x < W; ++x)
+            {
+                float sx = std::max(0.0f, std::min(maxX, x - u[x] * c.dt));
+                float sy = std::max(0.0f, std::min(maxY, y - v[x] * c.dt));
+                int   x0 = static_cast<int>(sx);
+                int   y0 = static_cast<int>(sy);
+                int   x1 = std::min(x0 + 1, W - 1);
+                int   y1 = std::min(y0 + 1, H - 1);
+                float tx = sx - x0;
+                float ty = sy - y0;
+
+                const float* s0 = &m_Sediment[static_cast<size_t>(y0) * W];
+                const float* s1 = &m_Sediment[static_cast<size_t>(y1) * W];
+                ns[x]           = (1.0f - ty) * ((1.0f - tx) * s0[x0] + tx * s0[x1]) + ty * ((1.0f - tx) * s1[x0] + tx * s1[x1]);
+            }
+
+            float* d = &m_Water[row];
+            for (int x = 0; x < W; ++x)
+                d[x] = d[x] * keep + rain;
+        }
+    });
+    std::swap(m_Sediment, m_NewSediment);
+}
+
+} // namespace Diligent
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+
+namespace Diligent
+{
+
+class ErosionEngine;
+
+// Parmetros del modelo de tuberas virtuales
+struct PipeErosionParams
+{
+    float timeStep          = 0.05f;  // Paso de tiempo de la simulacin
+    float rain              = 0.1f;   // Agua que cae en cada celda por unidad de tiempo
+    float gravity           = 9.81f;  // Aceleracin del agua entre celdas vecinas
+    float capacity          = 0.05f;  // Capacidad de sedimento (Kc)
+    float dissolving        = 0.1f;   // Velocidad de disolucin del terreno (Ks)
+    float deposition        = 0.1f;   // Velocidad de deposicin (Kd)
+    float evaporation       = 0.1f;   // Tasa de evaporacin por unidad de tiempo (Ke)
+    float minTilt           = 0.05f;  // Seno mnimo de la pendiente para la capacidad
+    float erosionDepth      = 1.0f;   // Profundidad del agua con la que la capacidad es completa
+    float heightScale       = 128.0f; // Alturas del mapa [0, 1] en celdas
+    int   stepsPerIteration = 50;     // Pasos de simulacin por iteracin
+};
+
+// Erosin hidrulica en rejilla con el modelo de "tuberas virtuales" (aguas poco profundas):
+// cada celda guarda el agua, el flujo de salida hacia sus 4 vecinas, la velocidad y el
+// sedimento. Cada paso son pasadas de plantilla sobre filas independientes, en estructuras de
+// arrays y sin escrituras dispersas, as que se reparten por filas entre los hilos del motor y
+// los bucles internos se pueden vectorizar. El terreno y el sedimento usan doble buffer.
+//
+// El agua, el flujo y el sedimento se conservan entre iteraciones; Run() toma el terreno del
+// motor al empezar y deja la diferencia en su mapa de cambios, como Simulate().
+class PipeErosion
+{
+public:
+    PipeErosionParams Params;
+
+    // Vaca el agua, los flujos y el sedimento
+    void Reset();
+
+    // Params.stepsPerIteration pasos sobre el terreno del motor, con engine.NumThreads hilos
+    void Run(ErosionEngine& engine);
+
+    float GetLastSeconds() const { return m_LastSeconds; }
+    float GetTotalWater() const { return m_TotalWater; }
+
+private:
+    void Resize(unsigned int width, unsigned int height);
+    void Step(int numThreads);
+
+    unsigned int m_Width  = 0;
+    unsigned int m_Height = 0;
+
+    std::vector<float> m_Terrain;     // Altura del terreno, en celdas
+    std::vector<float> m_NewTerrain;  // Doble buffer del terreno
+    std::vector<float> m_Water;       // Profundidad del agua
+    std::vector<float> m_FluxL;       // Flujo de salida hacia x - 1
+    std::vector<float> m_FluxR;       // Flujo de salida hacia x + 1
+    std::vector<float> m_FluxT;       // Flujo de salida hacia y - 1
+    std::vector<float> m_FluxB;       // Flujo de salida hacia y + 1
+    std::vector<float> m_VelocityX;   // Velocidad del agua
+    std::vector<float> m_VelocityY;   //
+    std::vector<float> m_Sediment;    // Sedimento en suspensin
+    std::vector<float> m_NewSediment; // Doble buffer del sedimento
+
+    float m_LastSeconds = 0; // Duracin de la ltima iteracin
+    float m_TotalWater  = 0; // Agua total al final de la ltima iteracin
+};
+
+} // namespace Diligent
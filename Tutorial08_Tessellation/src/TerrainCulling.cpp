@@ -0,0 +1,302 @@
+#include "TerrainCulling.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Planos del frustum, con el interior donde a * x + b * y + c * z + d >= 0, y los valores
+// absolutos de las normales para proyectar los semiejes de las cajas
+struct FrustumPlanes
+{
+    float A[6], B[6], C[6], D[6];
+    float AbsA[6], AbsB[6], AbsC[6];
+};
+
+// Planos de la matriz mundo-vista-proyeccin (vectores fila: clip = p * M), sacados de sus
+// columnas. El plano cercano es z >= 0 en Direct3D y Vulkan, y z >= -w en OpenGL.
+FrustumPlanes ExtractPlanes(const float4x4& m, bool isGL)
+{
+    // clang-format off
+    const float planes[6][4] =
+    {
+        {m._14 + m._11, m._24 + m._21, m._34 + m._31, m._44 + m._41}, // Izquierdo
+        {m._14 - m._11, m._24 - m._21, m._34 - m._31, m._44 - m._41}, // Derecho
+        {m._14 + m._12, m._24 + m._22, m._34 + m._32, m._44 + m._42}, // Inferior
+        {m._14 - m._12, m._24 - m._22, m._34 - m._32, m._44 - m._42}, // Superior
+        {isGL ? m._14 + m._13 : m._13, isGL ? m._24 + m._23 : m._23, isGL ? m._34 + m._33 : m._33, isGL ? m._44 + m._43 : m._43}, // Cercano
+        {m._14 - m._13, m._24 - m._23, m._34 - m._33, m._44 - m._43}, // Lejano
+    };
+    // clang-format on
+
+    FrustumPlanes frustum;
+    for (int p = 0; p < 6; ++p)
+    {
+        frustum.A[p]    = planes[p][0];
+        frustum.B[p]    = planes[p][1];
+        frustum.C[p]    = planes[p][2];
+        frustum.D[p]    = planes[p][3];
+        frustum.AbsA[p] = std::abs(planes[p][0]);
+        frustum.AbsB[p] = std::abs(planes[p][1]);
+        frustum.AbsC[p] = std::abs(planes[p][2]);
+    }
+    return frustum;
+}
+
+// Distancia (sin normalizar) de las cajas a los planos: outer es la mnima de la esquina ms
+// exterior de cada caja e inner la de la esquina ms interior. Sin saltos, para que se vectorice.
+void TestBoxes(const FrustumPlanes& frustum,
+               const float* __restrict cx,
+               const float* __restrict cy,
+               const float* __restrict cz,
+               const float* __restrict ex,
+               const float* __restrict ey,
+               const float* __restrict ez,
+               float* __restrict outer,
+               float* __restrict inner,
+               size_t count)
+{
+    const FrustumPlanes f = frustum;
+    for (size_t i = 0; i < count; ++i)
+    {
+        float minOuter = FLT_MAX;
+        float minInner = FLT_MAX;
+        for (int p = 0; p < 6; ++p)
+        {
+            const float distance = f.A[p] * cx[i] + f.B[p] * cy[i] + f.C[p] * cz[i] + f.D[p];
+            const float radius   = f.AbsA[p] * ex[i] + f.AbsB[p] * ey[i] + f.AbsC[p] * ez[i];
+            minOuter             = std::min(minOuter, distance + radius);
+            minInner             = std::min(minInner, distance - radius);
+        }
+        outer[i] = minOuter;
+        inner[i] = minInner;
+    }
+}
+
+} // namespace
+
+void TerrainCulling::Build(const Uint8* heights, Uint32 width, Uint32 height, Uint32 numBlocksX, Uint32 numBlocksY)
+{
+    m_Width  = width;
+    m_Height = height;
+    m_Levels.clear();
+    if (numBlocksX == 0 || numBlocksY == 0)
+        return;
+
+    // Celdas que muestrea cada bloque: el shader lee la textura con filtro lineal entre las
+    // coordenadas uv de los bordes del bloque, as que se incluye la celda vecina de cada lado
+    auto cellRange = [](Uint32 numBlocks, Uint32 size, std::vector<Uint32>& first, std::vector<Uint32>& last) {
+        first.resize(numBlocks);
+        last.resize(numBlocks);
+        for (Uint32 b = 0; b < numBlocks; ++b)
+        {
+            const double t0 = static_cast<double>(b) / numBlocks * size - 0.5;
+            const double t1 = static_cast<double>(b + 1) / numBlocks * size - 0.5;
+            first[b]        = static_cast<Uint32>(std::max(0.0, std::floor(t0)));
+            last[b]         = std::min(size - 1, static_cast<Uint32>(std::max(0.0, std::floor(t1) + 1.0)));
+        }
+    };
+    cellRange(numBlocksX, width, m_BlockX0, m_BlockX1);
+    cellRange(numBlocksY, height, m_BlockY0, m_BlockY1);
+
+    // Cada nivel junta 2x2 nodos del anterior hasta quedar en uno
+    Uint32 levelWidth = numBlocksX, levelHeight = numBlocksY;
+    while (true)
+    {
+        Level level;
+        level.Width  = levelWidth;
+        level.Height = levelHeight;
+        level.MinHeights.resize(static_cast<size_t>(levelWidth) * levelHeight);
+        level.MaxHeights.resize(level.MinHeights.size());
+        m_Levels.push_back(std::move(level));
+        if (levelWidth == 1 && levelHeight == 1)
+            break;
+        levelWidth  = (levelWidth + 1) / 2;
+        levelHeight = (levelHeight + 1) / 2;
+    }
+
+    for (Uint32 by = 0; by < numBlocksY; ++by)
+        for (Uint32 bx = 0; bx < numBlocksX; ++bx)
+            UpdateBlock(heights, bx, by);
+    for (Uint32 level = 1; level < m_Levels.size(); ++level)
+        for (Uint32 ny = 0; ny < m_Levels[level].Height; ++ny)
+            for (Uint32 nx = 0; nx < m_Levels[level].Width; ++nx)
+                UpdateNode(level, nx, ny);
+}
+
+void TerrainCulling::UpdateBlock(const Uint8* heights, Uint32 bx, Uint32 by)
+{
+    Uint8 minHeight = 255, maxHeight = 0;
+    for (Uint32 y = m_BlockY0[by]; y <= m_BlockY1[by]; ++y)
+    {
+        const Uint8* row = heights + static_cast<size_t>(y) * m_Width;
+        for (Uint32 x = m_BlockX0[bx]; x <= m_BlockX1[bx]; ++x)
+        {
+            minHeight = std::min(minHeight, row[x]);
+            maxHeight = std::max(maxHeight, row[x]);
+        }
+    }
+
+    Level&       blocks = m_Levels[0];
+    const size_t block  = static_cast<size_t>(by) * blocks.Width + bx;
+    blocks.MinHeights[block] = minHeight;
+    blocks.MaxHeights[block] = maxHeight;
+}
+
+void TerrainCulling::UpdateNode(Uint32 level, Uint32 nx, Uint32 ny)
+{
+    const Level& children  = m_Levels[level - 1];
+    Uint8        minHeight = 255, maxHeight = 0;
+    for (Uint32 childY = 2 * ny; childY < std::min(2 * ny + 2, children.Height); ++childY)
+    {
+        for (Uint32 childX = 2 * nx; childX < std::min(2 * nx + 2, children.Width); ++childX)
+        {
+            const size_t child = static_cast<size_t>(childY) * children.Width + childX;
+            minHeight          = std::min(minHeight, children.MinHeights[child]);
+            maxHeight          = std::max(maxHeight, children.MaxHeights[child]);
+        }
+    }
+
+    Level&       nodes = m_Levels[level];
+    const size_t node  = static_cast<size_t>(ny) * nodes.Width + nx;
+    nodes.MinHeights[node] = minHeight;
+    nodes.MaxHeights[node] = maxHeight;
+}
+
+void TerrainCulling::Update(const Uint8* heights, const std::vector<HeightmapRegion>& regions)
+{
+    if (m_Levels.empty())
+        return;
+
+    const Uint32 numBlocksX = GetNumBlocksX();
+    const Uint32 numBlocksY = GetNumBlocksY();
+    for (const auto& region : regions)
+    {
+        if (region.Width == 0 || region.Height == 0)
+            continue;
+
+        // Bloques que muestrean alguna celda de la regin
+        Uint32 bx0 = 0, by0 = 0;
+        while (bx0 < numBlocksX && m_BlockX1[bx0] < region.X)
+            ++bx0;
+        while (by0 < numBlocksY && m_BlockY1[by0] < region.Y)
+            ++by0;
+        Uint32 bx1 = bx0, by1 = by0;
+        while (bx1 < numBlocksX && m_BlockX0[bx1] < region.X + region.Width)
+            ++bx1;
+        while (by1 < numBlocksY && m_BlockY0[by1] < region.Y + region.Height)
+            ++by1;
+        if (bx0 >= bx1 || by0 >= by1)
+            continue;
+
+        for (Uint32 by = by0; by < by1; ++by)
+            for (Uint32 bx = bx0; bx < bx1; ++bx)
+                UpdateBlock(heights, bx, by);
+
+        // Nodos superiores de esos bloques, nivel por nivel
+        for (Uint32 level = 1; level < m_Levels.size(); ++level)
+        {
+            for (Uint32 ny = by0 >> level; ny <= (by1 - 1) >> level; ++ny)
+                for (Uint32 nx = bx0 >> level; nx <= (bx1 - 1) >> level; ++nx)
+                    UpdateNode(level, nx, ny);
+        }
+    }
+}
+
+void TerrainCulling::Cull(const float4x4& worldViewProj, bool isGL, float lengthScale, float heightScale, std::vector<Uint32>& visibleBlocks)
+{
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    visibleBlocks.clear();
+    m_Stats = TerrainCullingStats{};
+    if (m_Levels.empty())
+        return;
+
+    const FrustumPlanes frustum    = ExtractPlanes(worldViewProj, isGL);
+    const Uint32        numBlocksX = GetNumBlocksX();
+    const Uint32        numBlocksY = GetNumBlocksY();
+    m_Stats.TotalBlocks            = numBlocksX * numBlocksY;
+
+    // Empezar por todos los nodos del nivel superior
+    const Uint32 topLevel = static_cast<Uint32>(m_Levels.size()) - 1;
+    m_Candidates.resize(static_cast<size_t>(m_Levels[topLevel].Width) * m_Levels[topLevel].Height);
+    for (Uint32 i = 0; i < m_Candidates.size(); ++i)
+        m_Candidates[i] = i;
+
+    for (Uint32 level = topLevel + 1; level-- > 0 && !m_Candidates.empty();)
+    {
+        const Level& nodes = m_Levels[level];
+        const size_t count = m_Candidates.size();
+
+        // Cajas de los candidatos, en las coordenadas del dominio de los shaders:
+        // x y z a partir de las uv del bloque, y la altura
+        m_BoxData.resize(count * 6);
+        m_Outer.resize(count);
+        m_Inner.resize(count);
+        float* cx = m_BoxData.data();
+        float* cy = cx + count;
+        float* cz = cy + count;
+        float* ex = cz + count;
+        float* ey = ex + count;
+        float* ez = ey + count;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Uint32 node = m_Candidates[i];
+            const Uint32 nx   = node % nodes.Width;
+            const Uint32 ny   = node / nodes.Width;
+
+            const float x0 = (static_cast<float>(nx << level) / numBlocksX - 0.5f) * lengthScale;
+            const float x1 = (static_cast<float>(std::min((nx + 1) << level, numBlocksX)) / numBlocksX - 0.5f) * lengthScale;
+            const float z0 = (static_cast<float>(ny << level) / numBlocksY - 0.5f) * lengthScale;
+            const float z1 = (static_cast<float>(std::min((ny + 1) << level, numBlocksY)) / numBlocksY - 0.5f) * lengthScale;
+            // Los valores de 8 bits se redondean hacia abajo al subirlos: una unidad de margen arriba
+            const float y0 = nodes.MinHeights[node] / 255.0f * heightScale;
+            const float y1 = (nodes.MaxHeights[node] + 1) / 255.0f * heightScale;
+
+            cx[i] = (x0 + x1) * 0.5f;
+            cy[i] = (y0 + y1) * 0.5f;
+            cz[i] = (z0 + z1) * 0.5f;
+            ex[i] = (x1 - x0) * 0.5f;
+            ey[i] = (y1 - y0) * 0.5f;
+            ez[i] = (z1 - z0) * 0.5f;
+        }
+        TestBoxes(frustum, cx, cy, cz, ex, ey, ez, m_Outer.data(), m_Inner.data(), count);
+        m_Stats.TestedNodes += static_cast<Uint32>(count);
+
+        m_NextCandidates.clear();
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (m_Outer[i] < 0)
+                continue;
+
+            const Uint32 node = m_Candidates[i];
+            const Uint32 nx   = node % nodes.Width;
+            const Uint32 ny   = node / nodes.Width;
+            if (level == 0 || m_Inner[i] >= 0)
+            {
+                // Todos los bloques del nodo son visibles
+                for (Uint32 by = ny << level; by < std::min((ny + 1) << level, numBlocksY); ++by)
+                    for (Uint32 bx = nx << level; bx < std::min((nx + 1) << level, numBlocksX); ++bx)
+                        visibleBlocks.push_back(by * numBlocksX + bx);
+                continue;
+            }
+
+            // El nodo corta algn plano: probar sus hijos en el nivel siguiente
+            const Level& children = m_Levels[level - 1];
+            for (Uint32 childY = 2 * ny; childY < std::min(2 * ny + 2, children.Height); ++childY)
+                for (Uint32 childX = 2 * nx; childX < std::min(2 * nx + 2, children.Width); ++childX)
+                    m_NextCandidates.push_back(childY * children.Width + childX);
+        }
+        std::swap(m_Candidates, m_NextCandidates);
+    }
+
+    m_Stats.VisibleBlocks = static_cast<Uint32>(visibleBlocks.size());
+    m_Stats.Seconds       = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+} // namespace Diligent
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "BasicMath.hpp"
+#include "ErosionEngine.hpp"
+#include <vector>
+
+namespace Diligent
+{
+
+// Resultado de la ltima llamada a TerrainCulling::Cull
+struct TerrainCullingStats
+{
+    Uint32 TotalBlocks   = 0; // Bloques del terreno
+    Uint32 VisibleBlocks = 0; // Bloques en la lista de bloques visibles
+    Uint32 TestedNodes   = 0; // Cajas comparadas con el frustum, de todos los niveles
+    float  Seconds       = 0; // Duracin de la llamada
+};
+
+// Frustum culling de los bloques del terreno (los parches de BlockSize celdas que dibuja
+// Render). Guarda una pirmide con las alturas mnima y mxima de cada bloque, de cada grupo
+// de 2x2 bloques, de 4x4... hasta un solo nodo, calculadas de las alturas de 8 bits que se
+// suben a la textura. Update() solo recalcula los bloques que tocan las regiones modificadas
+// y sus nodos superiores.
+//
+// Cull() recorre la pirmide desde arriba: los nodos fuera del frustum se descartan con todos
+// sus bloques, los que estn dentro aceptan todos sus bloques sin ms pruebas, y solo los que
+// cortan un plano bajan al nivel siguiente. En cada nivel las cajas de los nodos candidatos
+// se comparan con los 6 planos en un bucle sin saltos sobre arrays (x, y, z por separado),
+// que el compilador vectoriza.
+class TerrainCulling
+{
+public:
+    // Pirmide completa de un mapa de width x height alturas dividido en numBlocksX x numBlocksY bloques
+    void Build(const Uint8* heights, Uint32 width, Uint32 height, Uint32 numBlocksX, Uint32 numBlocksY);
+
+    // Recalcula los bloques que tocan las regiones modificadas de heights
+    void Update(const Uint8* heights, const std::vector<HeightmapRegion>& regions);
+
+    // Lista de bloques (by * numBlocksX + bx) que pueden verse con la matriz worldViewProj, con
+    // las mismas escalas que los shaders del terreno
+    void Cull(const float4x4& worldViewProj, bool isGL, float lengthScale, float heightScale, std::vector<Uint32>& visibleBlocks);
+
+    Uint32                     GetNumBlocksX() const { return m_Levels.empty() ? 0 : m_Levels[0].Width; }
+    Uint32                     GetNumBlocksY() const { return m_Levels.empty() ? 0 : m_Levels[0].Height; }
+    const TerrainCullingStats& GetStats() const { return m_Stats; }
+
+private:
+    struct Level
+    {
+        Uint32             Width  = 0; // Nodos por fila
+        Uint32             Height = 0; // Filas de nodos
+        std::vector<Uint8> MinHeights;
+        std::vector<Uint8> MaxHeights;
+    };
+
+    void UpdateBlock(const Uint8* heights, Uint32 bx, Uint32 by);
+    void UpdateNode(Uint32 level, Uint32 nx, Uint32 ny);
+
+    Uint32              m_Width  = 0;
+    Uint32              m_Height = 0;
+    std::vector<Level>  m_Levels;  // Nivel 0: un nodo por bloque
+    std::vector<Uint32> m_BlockX0; // Primera columna de celdas que muestrea cada columna de bloques
+    std::vector<Uint32> m_BlockX1; // ltima columna, incluida
+    std::vector<Uint32> m_BlockY0; // Igual para las filas
+    std::vector<Uint32> m_BlockY1; //
+
+    // Nodos candidatos de un nivel, y sus cajas en arrays separados para el bucle vectorizado
+    std::vector<Uint32> m_Candidates;
+    std::vector<Uint32> m_NextCandidates;
+    std::vector<float>  m_BoxData; // Centro x, y, z y semiejes x, y, z, cada uno de m_Candidates.size() valores
+    std::vector<float>  m_Outer;   // Mnima distancia de la esquina ms exterior a los planos: < 0, fuera
+    std::vector<float>  m_Inner;   // Mnima distancia de la esquina ms interior: >= 0, dentro
+
+    TerrainCullingStats m_Stats;
+};
+
+} // namespace Diligent
@@ -0,0 +1,171 @@
+#include "TerrainPageCache.hpp"
+#include "TiledTerrain.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace Diligent
+{
+
+std::uint64_t TerrainPageCache::Key(unsigned int level, unsigned int tx, unsigned int ty)
+{
+    return static_cast<std::uint64_t>(level) << 56 | static_cast<std::uint64_t>(ty) << 28 | tx;
+}
+
+void TerrainPageCache::SetTerrain(const TiledTerrain* terrain)
+{
+    m_Terrain = terrain;
+    m_Pages.clear();
+    m_Placed.clear();
+    m_WindowWidth  = 0;
+    m_WindowHeight = 0;
+    m_PendingTiles = 0;
+    m_TileBytes    = terrain != nullptr ? static_cast<size_t>(terrain->GetTileSize()) * terrain->GetTileSize() * sizeof(float) : 0;
+}
+
+TerrainPageCache::Page* TerrainPageCache::Load(unsigned int level, unsigned int tx, unsigned int ty)
+{
+    // Hacer sitio descartando los tiles usados hace ms tiempo, pero nunca los de esta llamada
+    while (!m_Pages.empty() && (m_Pages.size() + 1) * m_TileBytes > MemoryLimit)
+    {
+        auto oldest = std::min_element(m_Pages.begin(), m_Pages.end(),
+                                       [](const auto& a, const auto& b) { return a.second.LastUse < b.second.LastUse; });
+        if (oldest->second.LastUse == m_Frame)
+            break;
+        m_Pages.erase(oldest);
+    }
+
+    // Leer el tile del archivo proyectado: el sistema trae del disco las pginas que falten
+    const unsigned int   tileSize = m_Terrain->GetTileSize();
+    const std::uint16_t* tile     = m_Terrain->GetTile(level, tx, ty);
+
+    Page& page = m_Pages[Key(level, tx, ty)];
+    page.Heights.resize(static_cast<size_t>(tileSize) * tileSize);
+    for (size_t i = 0; i < page.Heights.size(); ++i)
+        page.Heights[i] = tile[i] * (1.0f / 65535.0f);
+    page.LastUse = m_Frame;
+    ++m_TotalLoads;
+    return &page;
+}
+
+void TerrainPageCache::CopyToWindow(ErosionEngine& engine, const Page& page, unsigned int tx, unsigned int ty)
+{
+    const unsigned int tileSize    = m_Terrain->GetTileSize();
+    const unsigned int levelWidth  = m_Terrain->GetWidth(m_WindowLevel);
+    const unsigned int levelHeight = m_Terrain->GetHeight(m_WindowLevel);
+
+    // Celdas de la ventana que toman sus alturas de este tile; el ltimo tile de cada eje
+    // tambin cubre la parte de la ventana que queda fuera del nivel
+    const unsigned int x0 = std::max(tx * tileSize, m_WindowX) - m_WindowX;
+    const unsigned int y0 = std::max(ty * tileSize, m_WindowY) - m_WindowY;
+    const unsigned int x1 = (tx + 1) * tileSize >= levelWidth ? m_WindowWidth : std::min(m_WindowWidth, (tx + 1) * tileSize - m_WindowX);
+    const unsigned int y1 = (ty + 1) * tileSize >= levelHeight ? m_WindowHeight : std::min(m_WindowHeight, (ty + 1) * tileSize - m_WindowY);
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    const unsigned int width = x1 - x0;
+    m_CopyBuffer.resize(static_cast<size_t>(width) * (y1 - y0));
+    for (unsigned int y = y0; y < y1; ++y)
+    {
+        const unsigned int tileY = std::min(m_WindowY + y, levelHeight - 1) - ty * tileSize;
+        const float*       src   = &page.Heights[static_cast<size_t>(tileY) * tileSize];
+        float*             dst   = &m_CopyBuffer[static_cast<size_t>(y - y0) * width];
+        for (unsigned int x = x0; x < x1; ++x)
+            dst[x - x0] = src[std::min(m_WindowX + x, levelWidth - 1) - tx * tileSize];
+    }
+    engine.SetRegion(x0, y0, width, y1 - y0, m_CopyBuffer.data(), width);
+}
+
+int TerrainPageCache::UpdateWindow(ErosionEngine& engine, unsigned int level, unsigned int x, unsigned int y)
+{
+    m_LastLoads = 0;
+    if (m_Terrain == nullptr || level >= m_Terrain->GetLevelCount() || engine.GetWidth() == 0)
+        return 0;
+
+    const unsigned int tileSize = m_Terrain->GetTileSize();
+    const unsigned int tilesX   = m_Terrain->GetTilesX(level);
+    const unsigned int tilesY   = m_Terrain->GetTilesY(level);
+
+    x = std::min(x, (tilesX - 1) * tileSize);
+    y = std::min(y, (tilesY - 1) * tileSize);
+
+    // Tiles del nivel que cubren la ventana
+    const unsigned int tx0 = x / tileSize, tx1 = std::min(tilesX - 1, (x + engine.GetWidth() - 1) / tileSize);
+    const unsigned int ty0 = y / tileSize, ty1 = std::min(tilesY - 1, (y + engine.GetHeight() - 1) / tileSize);
+    const unsigned int windowTilesX = tx1 - tx0 + 1;
+
+    if (level != m_WindowLevel || x != m_WindowX || y != m_WindowY || engine.GetWidth() != m_WindowWidth || engine.GetHeight() != m_WindowHeight)
+    {
+        m_WindowLevel  = level;
+        m_WindowX      = x;
+        m_WindowY      = y;
+        m_WindowWidth  = engine.GetWidth();
+        m_WindowHeight = engine.GetHeight();
+        m_Placed.assign(static_cast<size_t>(windowTilesX) * (ty1 - ty0 + 1), 0);
+    }
+    ++m_Frame;
+
+    // Tiles pendientes, del centro de la ventana hacia fuera
+    const float centerX = (x + m_WindowWidth * 0.5f) / tileSize - 0.5f;
+    const float centerY = (y + m_WindowHeight * 0.5f) / tileSize - 0.5f;
+
+    std::vector<std::pair<float, unsigned int>> pending;
+    for (unsigned int ty = ty0; ty <= ty1; ++ty)
+    {
+        for (unsigned int tx = tx0; tx <= tx1; ++tx)
+        {
+            const unsigned int slot = (ty - ty0) * windowTilesX + (tx - tx0);
+            if (!m_Placed[slot])
+                pending.emplace_back(std::hypot(tx - centerX, ty - centerY), slot);
+        }
+    }
+    std::sort(pending.begin(), pending.end());
+
+    const auto start  = std::chrono::high_resolution_clock::now();
+    int        copied = 0;
+    for (const auto& entry : pending)
+    {
+        const unsigned int tx = tx0 + entry.second % windowTilesX;
+        const unsigned int ty = ty0 + entry.second / windowTilesX;
+
+        Page* page = nullptr;
+        auto  it   = m_Pages.find(Key(level, tx, ty));
+        if (it != m_Pages.end())
+        {
+            page          = &it->second;
+            page->LastUse = m_Frame;
+        }
+        else if (m_LastLoads < LoadsPerUpdate)
+        {
+            page = Load(level, tx, ty);
+            ++m_LastLoads;
+        }
+        if (page == nullptr)
+            continue;
+
+        CopyToWindow(engine, *page, tx, ty);
+        m_Placed[entry.second] = 1;
+        ++copied;
+    }
+    m_LastLoadSeconds = m_LastLoads > 0 ? std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count() : 0.0f;
+    m_PendingTiles    = static_cast<int>(pending.size()) - copied;
+    return copied;
+}
+
+void TerrainPageCache::Invalidate(const HeightmapRegion& region)
+{
+    if (m_Terrain == nullptr || region.Width == 0 || region.Height == 0)
+        return;
+
+    const unsigned int tileSize = m_Terrain->GetTileSize();
+    for (unsigned int level = 0; level < m_Terrain->GetLevelCount(); ++level)
+    {
+        const unsigned int tx0 = (region.X >> level) / tileSize, tx1 = ((region.X + region.Width - 1) >> level) / tileSize;
+        const unsigned int ty0 = (region.Y >> level) / tileSize, ty1 = ((region.Y + region.Height - 1) >> level) / tileSize;
+        for (unsigned int ty = ty0; ty <= ty1; ++ty)
+            for (unsigned int tx = tx0; tx <= tx1; ++tx)
+                m_Pages.erase(Key(level, tx, ty));
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "ErosionEngine.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Diligent
+{
+
+class TiledTerrain;
+
+// Cach en CPU de tiles de un TiledTerrain decodificados a alturas en [0, 1]. Mantiene una
+// ventana de un nivel del terreno, del tamao del mapa del motor de erosin, y la va
+// rellenando con los tiles que la cubren: primero los ms cercanos al centro, con un mximo de
+// lecturas del archivo por llamada para no parar el bucle de render. Cuando los tiles superan
+// MemoryLimit se descartan los usados hace ms tiempo.
+class TerrainPageCache
+{
+public:
+    size_t MemoryLimit    = size_t{256} << 20; // Memoria mxima de los tiles decodificados
+    int    LoadsPerUpdate = 8;                 // Tiles ledos del archivo como mximo en cada UpdateWindow()
+
+    // Vaca la cach y olvida la ventana; terrain puede ser nullptr
+    void SetTerrain(const TiledTerrain* terrain);
+
+    // Ventana del nivel level que empieza en la celda (x, y) de ese nivel. Copia al motor los
+    // tiles de la ventana que estn en la cach y todava no se copiaron, y carga los que
+    // faltan para las siguientes llamadas. Las celdas fuera del nivel repiten el borde. Si la
+    // ventana cambia, se vuelve a copiar completa. Devuelve los tiles copiados en esta llamada.
+    int UpdateWindow(ErosionEngine& engine, unsigned int level, unsigned int x, unsigned int y);
+
+    // Olvida los tiles ya copiados: la siguiente UpdateWindow() vuelve a copiar la ventana completa
+    void ReloadWindow() { m_WindowWidth = 0; }
+
+    // Descarta los tiles de todos los niveles que cubren una regin del nivel 0, despus de
+    // escribirla en el archivo y actualizar los mips
+    void Invalidate(const HeightmapRegion& region);
+
+    int           GetPendingTiles() const { return m_PendingTiles; }
+    size_t        GetResidentTiles() const { return m_Pages.size(); }
+    size_t        GetMemoryUsage() const { return m_Pages.size() * m_TileBytes; }
+    int           GetLastLoads() const { return m_LastLoads; }
+    float         GetLastLoadSeconds() const { return m_LastLoadSeconds; }
+    std::uint64_t GetTotalLoads() const { return m_TotalLoads; }
+
+private:
+    struct Page
+    {
+        std::vector<float> Heights;     // TileSize x TileSize alturas
+        std::uint64_t      LastUse = 0; // Llamada a UpdateWindow() en la que se us por ltima vez
+    };
+
+    static std::uint64_t Key(unsigned int level, unsigned int tx, unsigned int ty);
+
+    Page* Load(unsigned int level, unsigned int tx, unsigned int ty);
+    void  CopyToWindow(ErosionEngine& engine, const Page& page, unsigned int tx, unsigned int ty);
+
+    const TiledTerrain*                     m_Terrain = nullptr;
+    std::unordered_map<std::uint64_t, Page> m_Pages;
+    size_t                                  m_TileBytes = 0;
+    std::uint64_t                           m_Frame     = 0;
+
+    // Ventana actual y tiles suyos ya copiados al motor
+    unsigned int               m_WindowLevel  = 0;
+    unsigned int               m_WindowX      = 0;
+    unsigned int               m_WindowY      = 0;
+    unsigned int               m_WindowWidth  = 0;
+    unsigned int               m_WindowHeight = 0;
+    std::vector<unsigned char> m_Placed;           // Tiles de la ventana, fila por fila
+    std::vector<float>         m_CopyBuffer;       // Parte de un tile que cae en la ventana
+    int                        m_PendingTiles = 0; // Tiles de la ventana todava sin copiar
+
+    int           m_LastLoads       = 0; // Tiles ledos en la ltima llamada
+    float         m_LastLoadSeconds = 0; // Duracin de esas lecturas
+    std::uint64_t m_TotalLoads      = 0;
+};
+
+} // namespace Diligent
@@ -0,0 +1,106 @@
+#include "ThermalErosion.hpp"
+#include "ErosionEngine.hpp"
+#include "ErosionParallel.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Parte de la diferencia de altura con una vecina que supera el talud, con su signo:
+// positiva si la vecina est ms alta (la celda recibe material), negativa si est ms baja.
+// Escrita como diff - clamp(diff) para que el compilador la convierta en min/max sin saltos.
+inline float Excess(float diff, float talus)
+{
+    return diff - std::min(std::max(diff, -talus), talus);
+}
+
+// Una iteracin sobre las celdas [x0, x1) de una fila. dl y dr son los desplazamientos de las
+// vecinas izquierda y derecha, up y dn los de las vecinas de arriba y abajo. En los bordes son
+// 0 y la vecina de fuera pasa a ser la propia celda (sin exceso) o una vecina del borde; como
+// las dos celdas de cada par se ven mutuamente, el material se sigue conservando.
+void RelaxRow(const float* __restrict h,
+              float* __restrict out,
+              int               up,
+              int               dn,
+              int               dl,
+              int               dr,
+              float             talus,
+              float             talusDiagonal,
+              float             rate,
+              int               x0,
+              int               x1)
+{
+    for (int x = x0; x < x1; ++x)
+    {
+        const float c = h[x];
+
+        float sum = Excess(h[x + dl] - c, talus) + Excess(h[x + dr] - c, talus) +
+            Excess(h[x + up] - c, talus) + Excess(h[x + dn] - c, talus);
+        sum += Excess(h[x + up + dl] - c, talusDiagonal) + Excess(h[x + up + dr] - c, talusDiagonal) +
+            Excess(h[x + dn + dl] - c, talusDiagonal) + Excess(h[x + dn + dr] - c, talusDiagonal);
+
+        out[x] = c + rate * sum;
+    }
+}
+
+} // namespace
+
+void ThermalErosion::Run(ErosionEngine& engine)
+{
+    const auto start      = std::chrono::high_resolution_clock::now();
+    const int  numThreads = std::max(1, engine.NumThreads);
+
+    m_Width  = engine.GetWidth();
+    m_Height = engine.GetHeight();
+    m_Heights.assign(engine.GetHeights().begin(), engine.GetHeights().end());
+    m_NewHeights.resize(m_Heights.size());
+
+    for (int i = 0; i < Params.iterations; ++i)
+        Step(numThreads);
+
+    engine.AccumulateChanges(m_Heights, 1.0f);
+
+    m_LastSeconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void ThermalErosion::Step(int numThreads)
+{
+    const int W = static_cast<int>(m_Width);
+    const int H = static_cast<int>(m_Height);
+
+    // Diferencia de altura mxima entre vecinas, en unidades del mapa
+    const float talus         = std::tan(Params.talusAngle * 3.14159265f / 180.0f) / Params.heightScale;
+    const float talusDiagonal = talus * std::sqrt(2.0f);
+    // Cada celda reparte con 8 vecinas: con strength = 1 un pico aislado baja ms o menos
+    // hasta el talud en una iteracin
+    const float rate = std::min(std::max(Params.strength, 0.0f), 1.0f) / 8.0f;
+
+    ParallelFor(H, numThreads, [&](int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; ++y)
+        {
+            const size_t row = static_cast<size_t>(y) * W;
+            const int    up  = y > 0 ? -W : 0;
+            const int    dn  = y < H - 1 ? W : 0;
+            const float* h   = &m_Heights[row];
+            float*       out = &m_NewHeights[row];
+
+            // Columna izquierda, interior y columna derecha, como en PipeErosion
+            if (W == 1)
+            {
+                RelaxRow(h, out, up, dn, 0, 0, talus, talusDiagonal, rate, 0, 1);
+                continue;
+            }
+            RelaxRow(h, out, up, dn, 0, 1, talus, talusDiagonal, rate, 0, 1);
+            RelaxRow(h, out, up, dn, -1, 1, talus, talusDiagonal, rate, 1, W - 1);
+            RelaxRow(h, out, up, dn, -1, 0, talus, talusDiagonal, rate, W - 1, W);
+        }
+    });
+    std::swap(m_Heights, m_NewHeights);
+}
+
+} // namespace Diligent
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+
+namespace Diligent
+{
+
+class ErosionEngine;
+
+// Parmetros de la erosin trmica
+struct ThermalErosionParams
+{
+    float talusAngle  = 30.0f;  // Pendiente mxima estable, en grados
+    float strength    = 0.5f;   // Fraccin del exceso que se mueve en cada iteracin [0, 1]
+    float heightScale = 41.0f;  // Alturas del mapa [0, 1] en celdas, para medir la pendiente
+    int   iterations  = 20;     // Iteraciones por llamada a Run()
+};
+
+// Erosin trmica (relajacin del talud): el material baja de las celdas cuya diferencia de
+// altura con alguna de sus 8 vecinas supera la pendiente del talud. Cada par de vecinas
+// intercambia una fraccin del exceso, con el mismo valor y signo contrario en las dos
+// celdas, as que el material total se conserva.
+//
+// Cada iteracin es una plantilla de 3x3 que lee un buffer y escribe el otro, sin escrituras
+// dispersas: se reparte por filas entre los hilos del motor y el bucle de cada fila se
+// vectoriza. Run() toma el terreno del motor y deja la diferencia en su mapa de cambios, as
+// que se puede intercalar con Simulate() o con PipeErosion.
+class ThermalErosion
+{
+public:
+    ThermalErosionParams Params;
+
+    // Params.iterations iteraciones sobre el terreno del motor, con engine.NumThreads hilos
+    void Run(ErosionEngine& engine);
+
+    float GetLastSeconds() const { return m_LastSeconds; }
+
+private:
+    void Step(int numThreads);
+
+    unsigned int       m_Width  = 0;
+    unsigned int       m_Height = 0;
+    std::vector<float> m_Heights;    // Terreno de la iteracin actual
+    std::vector<float> m_NewHeights; // Doble buffer del terreno
+
+    float m_LastSeconds = 0; // Duracin de la ltima llamada a Run()
+};
+
+} // namespace Diligent
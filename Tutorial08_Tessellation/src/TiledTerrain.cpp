@@ -0,0 +1,507 @@
+#include "TiledTerrain.hpp"
+#include "ErosionEngine.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    ifndef WIN32_LEAN_AND_MEAN
+#        define WIN32_LEAN_AND_MEAN
+#    endif
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace Diligent
+{
+
+namespace
+{
+
+constexpr char MagicValue[8] = {'T', 'E', 'R', 'R', 'T', 'I', 'L', '1'};
+
+// El primer nivel empieza en una pgina propia del archivo
+constexpr std::uint64_t DataOffset = 4096;
+
+struct FileHeader
+{
+    char          Magic[8];
+    std::uint32_t Width;
+    std::uint32_t Height;
+    std::uint32_t TileSize;
+    std::uint32_t Levels;
+    std::uint64_t LevelOffsets[TiledTerrain::MaxLevels];
+};
+static_assert(sizeof(FileHeader) <= DataOffset, "La cabecera debe caber antes del primer nivel");
+
+inline std::uint16_t ToHeight16(float height)
+{
+    return static_cast<std::uint16_t>(std::max(0.0f, std::min(1.0f, height)) * 65535.0f + 0.5f);
+}
+
+} // namespace
+
+TiledTerrain::~TiledTerrain()
+{
+    Close();
+}
+
+void TiledTerrain::BuildLevels(unsigned int width, unsigned int height)
+{
+    // Cada nivel mide la mitad que el anterior hasta que cabe en un tile
+    m_Levels = 0;
+
+    const std::uint64_t tileBytes = static_cast<std::uint64_t>(m_TileSize) * m_TileSize * sizeof(std::uint16_t);
+    std::uint64_t       offset    = DataOffset;
+    while (m_Levels < MaxLevels)
+    {
+        m_LevelWidth[m_Levels]  = width;
+        m_LevelHeight[m_Levels] = height;
+        m_LevelOffset[m_Levels] = offset;
+        offset += tileBytes * GetTilesX(m_Levels) * GetTilesY(m_Levels);
+        ++m_Levels;
+
+        if (width <= m_TileSize && height <= m_TileSize)
+            break;
+        width  = (width + 1) / 2;
+        height = (height + 1) / 2;
+    }
+    m_FileSize = offset;
+    m_DirtyTiles.assign(static_cast<size_t>(GetTilesX(0)) * GetTilesY(0), 0);
+}
+
+bool TiledTerrain::Create(const std::string& path, unsigned int width, unsigned int height, unsigned int tileSize)
+{
+    Close();
+    if (width == 0 || height == 0 || tileSize == 0)
+        return false;
+
+    m_TileSize = tileSize;
+    BuildLevels(width, height);
+    if (!Map(path, m_FileSize, true, true))
+        return false;
+
+    // El archivo nuevo est a cero: solo falta la cabecera
+    FileHeader header = {};
+    std::memcpy(header.Magic, MagicValue, sizeof(MagicValue));
+    header.Width    = width;
+    header.Height   = height;
+    header.TileSize = m_TileSize;
+    header.Levels   = m_Levels;
+    for (unsigned int level = 0; level < m_Levels; ++level)
+        header.LevelOffsets[level] = m_LevelOffset[level];
+    std::memcpy(m_Data, &header, sizeof(header));
+    return true;
+}
+
+bool TiledTerrain::Open(const std::string& path, bool writable)
+{
+    Close();
+    if (!Map(path, 0, false, writable))
+        return false;
+
+    const std::uint64_t mappedSize = m_FileSize;
+    FileHeader          header     = {};
+    bool                valid      = mappedSize >= DataOffset;
+    if (valid)
+    {
+        std::memcpy(&header, m_Data, sizeof(header));
+        valid = std::memcmp(header.Magic, MagicValue, sizeof(MagicValue)) == 0 && header.Width > 0 && header.Height > 0 && header.TileSize > 0;
+    }
+    if (valid)
+    {
+        // La disposicin de los niveles se deduce del tamao: la cabecera debe coincidir
+        m_TileSize = header.TileSize;
+        BuildLevels(header.Width, header.Height);
+        valid = header.Levels == m_Levels && m_FileSize <= mappedSize;
+        for (unsigned int level = 0; valid && level < m_Levels; ++level)
+            valid = header.LevelOffsets[level] == m_LevelOffset[level];
+        m_FileSize = mappedSize;
+    }
+    if (!valid)
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+#ifdef _WIN32
+
+bool TiledTerrain::Map(const std::string& path, std::uint64_t size, bool create, bool writable)
+{
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | (writable ? GENERIC_WRITE : 0), FILE_SHARE_READ, nullptr,
+                              create ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    m_File = file;
+
+    if (!create)
+    {
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+        {
+            Close();
+            return false;
+        }
+        size = static_cast<std::uint64_t>(fileSize.QuadPart);
+    }
+
+    // Al crear la proyeccin de un archivo nuevo con su tamao, el archivo se extiende con ceros
+    m_Mapping = CreateFileMappingA(file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY,
+                                   static_cast<DWORD>(size >> 32), static_cast<DWORD>(size & 0xFFFFFFFF), nullptr);
+    if (m_Mapping == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    m_Data = static_cast<unsigned char*>(MapViewOfFile(m_Mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0));
+    if (m_Data == nullptr)
+    {
+        Close();
+        return false;
+    }
+    m_FileSize = size;
+    m_Writable = writable;
+    return true;
+}
+
+void TiledTerrain::Close()
+{
+    if (m_Data != nullptr)
+        UnmapViewOfFile(m_Data);
+    if (m_Mapping != nullptr)
+        CloseHandle(m_Mapping);
+    if (m_File != nullptr)
+        CloseHandle(m_File);
+    m_Data     = nullptr;
+    m_Mapping  = nullptr;
+    m_File     = nullptr;
+    m_Writable = false;
+    m_Levels   = 0;
+}
+
+bool TiledTerrain::Flush()
+{
+    return m_Data != nullptr && (!m_Writable || FlushViewOfFile(m_Data, 0) != 0);
+}
+
+#else
+
+bool TiledTerrain::Map(const std::string& path, std::uint64_t size, bool create, bool writable)
+{
+    m_File = open(path.c_str(), (writable ? O_RDWR : O_RDONLY) | (create ? O_CREAT | O_TRUNC : 0), 0644);
+    if (m_File < 0)
+        return false;
+
+    if (create)
+    {
+        // El archivo se extiende con ceros; en la mayora de los sistemas de archivos no ocupa
+        // disco hasta que se escribe
+        if (ftruncate(m_File, static_cast<off_t>(size)) != 0)
+        {
+            Close();
+            return false;
+        }
+    }
+    else
+    {
+        struct stat fileStat;
+        if (fstat(m_File, &fileStat) != 0 || fileStat.st_size == 0)
+        {
+            Close();
+            return false;
+        }
+        size = static_cast<std::uint64_t>(fileStat.st_size);
+    }
+
+    void* data = mmap(nullptr, static_cast<size_t>(size), PROT_READ | (writable ? PROT_WRITE : 0), MAP_SHARED, m_File, 0);
+    if (data == MAP_FAILED)
+    {
+        Close();
+        return false;
+    }
+    m_Data     = static_cast<unsigned char*>(data);
+    m_FileSize = size;
+    m_Writable = writable;
+    return true;
+}
+
+void TiledTerrain::Close()
+{
+    if (m_Data != nullptr)
+        munmap(m_Data, static_cast<size_t>(m_FileSize));
+    if (m_File >= 0)
+        close(m_File);
+    m_Data     = nullptr;
+    m_File     = -1;
+    m_Writable = false;
+    m_Levels   = 0;
+}
+
+bool TiledTerrain::Flush()
+{
+    return m_Data != nullptr && (!m_Writable || msync(m_Data, static_cast<size_t>(m_FileSize), MS_SYNC) == 0);
+}
+
+#endif
+
+std::uint16_t* TiledTerrain::TileData(unsigned int level, unsigned int tx, unsigned int ty) const
+{
+    const std::uint64_t tileCells = static_cast<std::uint64_t>(m_TileSize) * m_TileSize;
+    const std::uint64_t tile      = static_cast<std::uint64_t>(ty) * GetTilesX(level) + tx;
+    return reinterpret_cast<std::uint16_t*>(m_Data + m_LevelOffset[level]) + tile * tileCells;
+}
+
+const std::uint16_t* TiledTerrain::GetTile(unsigned int level, unsigned int tx, unsigned int ty) const
+{
+    return TileData(level, tx, ty);
+}
+
+void TiledTerrain::ReadRegion(unsigned int level, int x, int y, unsigned int width, unsigned int height, float* heights, size_t stride) const
+{
+    const int levelWidth  = static_cast<int>(m_LevelWidth[level]);
+    const int levelHeight = static_cast<int>(m_LevelHeight[level]);
+    const int tileSize    = static_cast<int>(m_TileSize);
+
+    for (unsigned int row = 0; row < height; ++row)
+    {
+        const int mapY  = std::max(0, std::min(levelHeight - 1, y + static_cast<int>(row)));
+        float*    out   = heights + row * stride;
+        const int tileY = mapY / tileSize;
+        const int inY   = mapY % tileSize;
+
+        // Tramos de la fila dentro de un mismo tile; fuera del nivel se repite la celda del borde
+        for (int col = 0; col < static_cast<int>(width);)
+        {
+            const int mapX  = std::max(0, std::min(levelWidth - 1, x + col));
+            const int tileX = mapX / tileSize;
+            int       run   = 1;
+            if (x + col == mapX)
+                run = std::min({static_cast<int>(width) - col, (tileX + 1) * tileSize - mapX, levelWidth - mapX});
+
+            const std::uint16_t* src = TileData(level, tileX, tileY) + static_cast<size_t>(inY) * tileSize + mapX % tileSize;
+            for (int i = 0; i < run; ++i)
+                out[col + i] = src[i] * (1.0f / 65535.0f);
+            col += run;
+        }
+    }
+}
+
+void TiledTerrain::WriteRegion(unsigned int x, unsigned int y, unsigned int width, unsigned int height, const float* heights, size_t stride)
+{
+    if (width == 0 || height == 0)
+        return;
+
+    for (unsigned int row = 0; row < height; ++row)
+    {
+        const unsigned int mapY  = y + row;
+        const float*       src   = heights + row * stride;
+        const unsigned int tileY = mapY / m_TileSize;
+        const unsigned int inY   = mapY % m_TileSize;
+        for (unsigned int col = 0; col < width;)
+        {
+            const unsigned int mapX  = x + col;
+            const unsigned int tileX = mapX / m_TileSize;
+            const unsigned int run   = std::min(width - col, (tileX + 1) * m_TileSize - mapX);
+
+            std::uint16_t* dst = TileData(0, tileX, tileY) + static_cast<size_t>(inY) * m_TileSize + mapX % m_TileSize;
+            for (unsigned int i = 0; i < run; ++i)
+                dst[i] = ToHeight16(src[col + i]);
+            col += run;
+        }
+    }
+
+    const unsigned int tilesX = GetTilesX(0);
+    for (unsigned int ty = y / m_TileSize; ty <= (y + height - 1) / m_TileSize; ++ty)
+        for (unsigned int tx = x / m_TileSize; tx <= (x + width - 1) / m_TileSize; ++tx)
+            m_DirtyTiles[static_cast<size_t>(ty) * tilesX + tx] = 1;
+}
+
+void TiledTerrain::PadTile(unsigned int level, unsigned int tx, unsigned int ty)
+{
+    // Solo los tiles del borde derecho e inferior tienen celdas fuera del nivel
+    const unsigned int validWidth  = std::min(m_TileSize, m_LevelWidth[level] - tx * m_TileSize);
+    const unsigned int validHeight = std::min(m_TileSize, m_LevelHeight[level] - ty * m_TileSize);
+    if (validWidth == m_TileSize && validHeight == m_TileSize)
+        return;
+
+    std::uint16_t* tile = TileData(level, tx, ty);
+    for (unsigned int row = 0; row < validHeight; ++row)
+    {
+        std::uint16_t* line = tile + static_cast<size_t>(row) * m_TileSize;
+        std::fill(line + validWidth, line + m_TileSize, line[validWidth - 1]);
+    }
+    for (unsigned int row = validHeight; row < m_TileSize; ++row)
+        std::copy(tile + static_cast<size_t>(validHeight - 1) * m_TileSize, tile + static_cast<size_t>(validHeight) * m_TileSize,
+                  tile + static_cast<size_t>(row) * m_TileSize);
+}
+
+void TiledTerrain::DownsampleTile(unsigned int level, unsigned int tx, unsigned int ty)
+{
+    // Media de 2x2 celdas del nivel anterior; ReadRegion repite el borde si el nivel anterior
+    // tiene un nmero impar de celdas
+    const unsigned int validWidth  = std::min(m_TileSize, m_LevelWidth[level] - tx * m_TileSize);
+    const unsigned int validHeight = std::min(m_TileSize, m_LevelHeight[level] - ty * m_TileSize);
+    const unsigned int srcSize     = 2 * m_TileSize;
+
+    std::vector<float> source(static_cast<size_t>(srcSize) * srcSize);
+    ReadRegion(level - 1, static_cast<int>(tx * srcSize), static_cast<int>(ty * srcSize), 2 * validWidth, 2 * validHeight, source.data(), srcSize);
+
+    std::uint16_t* tile = TileData(level, tx, ty);
+    for (unsigned int y = 0; y < validHeight; ++y)
+    {
+        const float*   src0 = &source[static_cast<size_t>(2 * y) * srcSize];
+        const float*   src1 = src0 + srcSize;
+        std::uint16_t* dst  = tile + static_cast<size_t>(y) * m_TileSize;
+        for (unsigned int x = 0; x < validWidth; ++x)
+            dst[x] = ToHeight16((src0[2 * x] + src0[2 * x + 1] + src1[2 * x] + src1[2 * x + 1]) * 0.25f);
+    }
+    PadTile(level, tx, ty);
+}
+
+void TiledTerrain::UpdateMips()
+{
+    std::vector<unsigned char> dirty(m_DirtyTiles.size(), 0);
+    std::swap(dirty, m_DirtyTiles);
+
+    for (unsigned int ty = 0; ty < GetTilesY(0); ++ty)
+        for (unsigned int tx = 0; tx < GetTilesX(0); ++tx)
+            if (dirty[static_cast<size_t>(ty) * GetTilesX(0) + tx])
+                PadTile(0, tx, ty);
+
+    // Cada tile de un nivel cubre 2x2 tiles del anterior
+    for (unsigned int level = 1; level < m_Levels; ++level)
+    {
+        const unsigned int         childTilesX = GetTilesX(level - 1);
+        const unsigned int         tilesX      = GetTilesX(level);
+        std::vector<unsigned char> parents(static_cast<size_t>(tilesX) * GetTilesY(level), 0);
+        for (unsigned int ty = 0; ty < GetTilesY(level - 1); ++ty)
+            for (unsigned int tx = 0; tx < childTilesX; ++tx)
+                if (dirty[static_cast<size_t>(ty) * childTilesX + tx])
+                    parents[static_cast<size_t>(ty / 2) * tilesX + tx / 2] = 1;
+
+        for (unsigned int ty = 0; ty < GetTilesY(level); ++ty)
+            for (unsigned int tx = 0; tx < tilesX; ++tx)
+                if (parents[static_cast<size_t>(ty) * tilesX + tx])
+                    DownsampleTile(level, tx, ty);
+        dirty = std::move(parents);
+    }
+}
+
+bool TiledTerrain::ImportRaw16(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file || !m_Writable)
+        return false;
+
+    const unsigned int         width = m_LevelWidth[0];
+    std::vector<unsigned char> bytes;
+    std::vector<float>         strip;
+    for (unsigned int y = 0; y < m_LevelHeight[0]; y += m_TileSize)
+    {
+        const unsigned int rows = std::min(m_TileSize, m_LevelHeight[0] - y);
+        bytes.resize(static_cast<size_t>(width) * rows * 2);
+        if (!file.read(reinterpret_cast<char*>(bytes.data()), bytes.size()))
+            return false;
+
+        strip.resize(static_cast<size_t>(width) * rows);
+        for (size_t i = 0; i < strip.size(); ++i)
+            strip[i] = static_cast<float>(bytes[2 * i] | bytes[2 * i + 1] << 8) / 65535.0f;
+        WriteRegion(0, y, width, rows, strip.data(), width);
+    }
+    UpdateMips();
+    return true;
+}
+
+bool TiledTerrain::ExportRaw16(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file || !IsOpen())
+        return false;
+
+    const unsigned int         width = m_LevelWidth[0];
+    std::vector<unsigned char> bytes;
+    std::vector<float>         strip;
+    for (unsigned int y = 0; y < m_LevelHeight[0]; y += m_TileSize)
+    {
+        const unsigned int rows = std::min(m_TileSize, m_LevelHeight[0] - y);
+        strip.resize(static_cast<size_t>(width) * rows);
+        ReadRegion(0, 0, static_cast<int>(y), width, rows, strip.data(), width);
+
+        bytes.resize(strip.size() * 2);
+        for (size_t i = 0; i < strip.size(); ++i)
+        {
+            const std::uint16_t value = ToHeight16(strip[i]);
+            bytes[2 * i]              = static_cast<unsigned char>(value & 0xFF);
+            bytes[2 * i + 1]          = static_cast<unsigned char>(value >> 8);
+        }
+        if (!file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size()))
+            return false;
+    }
+    return true;
+}
+
+void ErodeTiled(TiledTerrain&                               terrain,
+                ErosionEngine&                              engine,
+                unsigned int                                windowSize,
+                unsigned int                                margin,
+                unsigned int                                pass,
+                const std::function<void(ErosionEngine&)>& erode)
+{
+    const int width  = static_cast<int>(terrain.GetWidth());
+    const int height = static_cast<int>(terrain.GetHeight());
+    const int size   = static_cast<int>(std::max(1u, windowSize));
+    const int border = static_cast<int>(margin);
+    const int offset = pass % 2 != 0 ? size / 2 : 0;
+
+    std::vector<float> original;
+    std::vector<float> blended;
+    for (int y = -offset; y < height; y += size)
+    {
+        for (int x = -offset; x < width; x += size)
+        {
+            // Interior de la ventana y regin cargada con el margen, dentro del mapa
+            const int ix0 = std::max(0, x), ix1 = std::min(width, x + size);
+            const int iy0 = std::max(0, y), iy1 = std::min(height, y + size);
+            if (ix0 >= ix1 || iy0 >= iy1)
+                continue;
+            const int          rx0 = std::max(0, ix0 - border), rx1 = std::min(width, ix1 + border);
+            const int          ry0 = std::max(0, iy0 - border), ry1 = std::min(height, iy1 + border);
+            const unsigned int rw  = static_cast<unsigned int>(rx1 - rx0);
+            const unsigned int rh  = static_cast<unsigned int>(ry1 - ry0);
+
+            original.resize(static_cast<size_t>(rw) * rh);
+            terrain.ReadRegion(0, rx0, ry0, rw, rh, original.data(), rw);
+            engine.SetHeightmap(original, rw, rh);
+            erode(engine);
+
+            // Peso 1 en el interior que baja linealmente a lo largo del margen
+            const std::vector<float>& eroded = engine.GetHeights();
+            blended.resize(original.size());
+            for (int row = 0; row < static_cast<int>(rh); ++row)
+            {
+                const int dy = std::max({iy0 - (ry0 + row), ry0 + row - (iy1 - 1), 0});
+                for (int col = 0; col < static_cast<int>(rw); ++col)
+                {
+                    const int    dx     = std::max({ix0 - (rx0 + col), rx0 + col - (ix1 - 1), 0});
+                    const float  weight = 1.0f - static_cast<float>(std::max(dx, dy)) / static_cast<float>(border + 1);
+                    const size_t i      = static_cast<size_t>(row) * rw + col;
+                    blended[i]          = original[i] + weight * (eroded[i] - original[i]);
+                }
+            }
+            terrain.WriteRegion(static_cast<unsigned int>(rx0), static_cast<unsigned int>(ry0), rw, rh, blended.data(), rw);
+        }
+    }
+    terrain.UpdateMips();
+}
+
+} // namespace Diligent
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Diligent
+{
+
+class ErosionEngine;
+
+// Terreno guardado en un archivo de tiles con su pirmide de mips, para mapas de alturas que
+// no caben en memoria (32k x 32k son 2 GB de alturas de 16 bits). El archivo se proyecta en
+// memoria: el sistema lee del disco solo las pginas de los tiles que se usan.
+//
+// Formato: una cabecera y despus los niveles, del 0 (resolucin completa) al ltimo, que
+// cabe en un tile. El nivel L mide ceil(ancho / 2^L) x ceil(alto / 2^L) celdas y cada celda
+// es la media de 2x2 celdas del nivel anterior. Cada nivel son tiles de TileSize x TileSize
+// alturas de 16 bits (little endian), tile por tile y fila por fila dentro de cada tile, as
+// que un tile es un bloque contiguo del archivo. Los tiles del borde se rellenan repitiendo
+// la ltima fila y columna del nivel.
+class TiledTerrain
+{
+public:
+    static constexpr unsigned int MaxLevels       = 16;
+    static constexpr unsigned int DefaultTileSize = 256;
+
+    TiledTerrain() = default;
+    ~TiledTerrain();
+
+    TiledTerrain(const TiledTerrain&) = delete;
+    TiledTerrain& operator=(const TiledTerrain&) = delete;
+
+    // Crea (o reemplaza) el archivo con el terreno a altura 0 y lo deja abierto para escribir
+    bool Create(const std::string& path, unsigned int width, unsigned int height, unsigned int tileSize = DefaultTileSize);
+    bool Open(const std::string& path, bool writable);
+    void Close();
+    // Escribe en el disco las pginas modificadas
+    bool Flush();
+
+    bool IsOpen() const { return m_Data != nullptr; }
+    bool IsWritable() const { return m_Writable; }
+
+    unsigned int GetWidth(unsigned int level = 0) const { return m_LevelWidth[level]; }
+    unsigned int GetHeight(unsigned int level = 0) const { return m_LevelHeight[level]; }
+    unsigned int GetTileSize() const { return m_TileSize; }
+    unsigned int GetLevelCount() const { return m_Levels; }
+    unsigned int GetTilesX(unsigned int level) const { return (m_LevelWidth[level] + m_TileSize - 1) / m_TileSize; }
+    unsigned int GetTilesY(unsigned int level) const { return (m_LevelHeight[level] + m_TileSize - 1) / m_TileSize; }
+    std::uint64_t GetFileSize() const { return m_FileSize; }
+
+    // TileSize x TileSize alturas de un tile, directamente del archivo proyectado
+    const std::uint16_t* GetTile(unsigned int level, unsigned int tx, unsigned int ty) const;
+
+    // Alturas en [0, 1] del rectngulo (x, y, width, height) de un nivel, en filas de stride
+    // valores. Las celdas fuera del nivel repiten el borde.
+    void ReadRegion(unsigned int level, int x, int y, unsigned int width, unsigned int height, float* heights, size_t stride) const;
+
+    // Escribe un rectngulo del nivel 0, que debe estar dentro del mapa, y marca sus tiles
+    // para que UpdateMips() recalcule los niveles siguientes
+    void WriteRegion(unsigned int x, unsigned int y, unsigned int width, unsigned int height, const float* heights, size_t stride);
+
+    // Recalcula los mips de los tiles escritos desde la llamada anterior, nivel por nivel
+    void UpdateMips();
+
+    // RAW de 16 bits (little endian, fila por fila) del tamao del nivel 0, ledo o escrito por
+    // franjas de TileSize filas, sin cargar el mapa completo en memoria
+    bool ImportRaw16(const std::string& path);
+    bool ExportRaw16(const std::string& path) const;
+
+private:
+    std::uint16_t* TileData(unsigned int level, unsigned int tx, unsigned int ty) const;
+    void           BuildLevels(unsigned int width, unsigned int height);
+    bool           Map(const std::string& path, std::uint64_t size, bool create, bool writable);
+    void           PadTile(unsigned int level, unsigned int tx, unsigned int ty);
+    void           DownsampleTile(unsigned int level, unsigned int tx, unsigned int ty);
+
+    unsigned int  m_TileSize               = 0;
+    unsigned int  m_Levels                 = 0;
+    unsigned int  m_LevelWidth[MaxLevels]  = {};
+    unsigned int  m_LevelHeight[MaxLevels] = {};
+    std::uint64_t m_LevelOffset[MaxLevels] = {}; // Posicin del primer tile de cada nivel en el archivo
+    std::uint64_t m_FileSize               = 0;
+
+    std::vector<unsigned char> m_DirtyTiles; // Tiles del nivel 0 escritos desde el ltimo UpdateMips()
+
+    unsigned char* m_Data     = nullptr; // Archivo proyectado
+    bool           m_Writable = false;
+#ifdef _WIN32
+    void* m_File    = nullptr;
+    void* m_Mapping = nullptr;
+#else
+    int m_File = -1;
+#endif
+};
+
+// Erosiona el nivel 0 del terreno por ventanas de windowSize x windowSize celdas: cada ventana
+// se carga en el motor con margin celdas ms de cada lado, erode() la erosiona (aplicando sus
+// cambios) y se escribe de vuelta. En el margen el resultado se mezcla con el terreno que haba,
+// con un peso que baja hasta 0 en el borde de la ventana, para que no queden escalones entre
+// ventanas. Con pass impar la rejilla de ventanas se desplaza media ventana, as que alternando
+// pasadas las costuras no quedan siempre en el mismo sitio. Al terminar se actualizan los mips.
+void ErodeTiled(TiledTerrain&                               terrain,
+                ErosionEngine&                              engine,
+                unsigned int                                windowSize,
+                unsigned int                                margin,
+                unsigned int                                pass,
+                const std::function<void(ErosionEngine&)>& erode);
+
+} // namespace Diligent
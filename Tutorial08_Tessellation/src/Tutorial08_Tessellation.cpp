@@ -4,9 +4,14 @@
 #include "TextureUtilities.h"
 #include "ColorConversion.h"
 #include "ShaderMacroHelper.hpp"
+#include "HeightmapImage.hpp"
 #include "imgui.h"
 #include <random>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <thread>
 
 namespace Diligent
 {
@@ -78,6 +83,17 @@ void Tutorial08_Tessellation::CreatePipelineStates()
     PSOCreateInfo.GraphicsPipeline.DepthStencilDesc.DepthEnable = True;
     // clang-format on
 
+    // Cada instancia es un parche de un bloque del terreno: el ndice del bloque llega en un
+    // buffer por instancia con la lista de bloques visibles
+    // clang-format off
+    LayoutElement LayoutElems[] =
+    {
+        LayoutElement{0, 0, 1, VT_UINT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE}
+    };
+    // clang-format on
+    PSOCreateInfo.GraphicsPipeline.InputLayout.LayoutElements = LayoutElems;
+    PSOCreateInfo.GraphicsPipeline.InputLayout.NumElements    = _countof(LayoutElems);
+
     // Create dynamic uniform buffer that will store shader constants
     CreateUniformBuffer(m_pDevice, sizeof(GlobalConstants), "Global shader constants CB", &m_ShaderConstants);
 
@@ -239,6 +255,15 @@ void Tutorial08_Tessellation::CreatePipelineStates()
 
 void Tutorial08_Tessellation::LoadTextures()
 {
+    // Decodificar las alturas para la erosin en otro hilo, directamente del archivo,
+    // mientras se crean las texturas
+    std::vector<float> decodedHeights;
+    unsigned int       decodedWidth  = 0;
+    unsigned int       decodedHeight = 0;
+    auto               heightsLoaded = std::async(std::launch::async, [&]() {
+        return LoadHeightmapImageCached("ps_height_1k.png", decodedHeights, decodedWidth, decodedHeight);
+    });
+
     {
         // Load height map texture
         TextureLoadInfo loadInfo;
@@ -253,9 +278,6 @@ void Tutorial08_Tessellation::LoadTextures()
         const auto& HMDesc = m_pHeightMap->GetDesc();
         m_HeightMapWidth   = HMDesc.Width;
         m_HeightMapHeight  = HMDesc.Height;
-
-        // Inicializar datos para la erosin
-        InitializeErosion();
     }
 
     {
@@ -269,6 +291,11 @@ void Tutorial08_Tessellation::LoadTextures()
         m_ColorMapSRV = m_pColorMap->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
     }
 
+    // Inicializar datos para la erosin
+    if (!heightsLoaded.get())
+        decodedHeights.clear();
+    InitializeErosion(std::move(decodedHeights), decodedWidth, decodedHeight);
+
     // Since we are using mutable variable, we must create a shader resource binding object
     // http://diligentgraphics.com/2016/03/23/resource-binding-model-in-diligent-engine-2-0/
     for (size_t i = 0; i < _countof(m_pPSO); ++i)
@@ -286,353 +313,253 @@ void Tutorial08_Tessellation::LoadTextures()
     }
 }
 
-void Tutorial08_Tessellation::InitializeErosion()
+void Tutorial08_Tessellation::CreateVisibleBlocksBuffer()
 {
-    // Inicializar con valores por defecto
-    m_HeightData.resize(m_HeightMapWidth * m_HeightMapHeight, 0.5f); // Mitad de la altura como predeterminado
-    m_OriginalHeightData.resize(m_HeightMapWidth * m_HeightMapHeight, 0.5f);
-    m_ErosionChangeMap.resize(m_HeightMapWidth * m_HeightMapHeight, 0.0f);
-    // Extraer datos del heightmap para procesamiento de erosin
-    TextureSubResData subresData;
-    Box               box;
-    box.MaxX = m_HeightMapWidth;
-    box.MaxY = m_HeightMapHeight;
-
-    std::vector<uint8_t> heightMapData(m_HeightMapWidth * m_HeightMapHeight * 4);
-    subresData.pData  = heightMapData.data();
-    subresData.Stride = m_HeightMapWidth * 4;
-
-    // Declarar mappedData como variable
-    MappedTextureSubresource mappedData;
-    m_pImmediateContext->MapTextureSubresource(m_pHeightMap, 0, 0, MAP_READ, MAP_FLAG_DO_NOT_WAIT, &box, mappedData);
-
-    // Resto del cdigo con acceso directo a mappedData (sin el operador ->)
-    for (unsigned int y = 0; y < m_HeightMapHeight; ++y)
-    {
-        for (unsigned int x = 0; x < m_HeightMapWidth; ++x)
-        {
-            for (unsigned int c = 0; c < 4; ++c)
-            {
-                unsigned int srcOffset = y * mappedData.Stride + x * 4 + c;
-                unsigned int dstOffset = y * m_HeightMapWidth * 4 + x * 4 + c;
-
-                // Verificacin de lmites
-                if (srcOffset < mappedData.Stride * m_HeightMapHeight && dstOffset < heightMapData.size())
-                {
-                    heightMapData[dstOffset] = *((uint8_t*)mappedData.pData + srcOffset);
-                }
-            }
-        }
-    }
-
-    m_pImmediateContext->UnmapTextureSubresource(m_pHeightMap, 0, 0);
-
-    // Convertir a float para mejor procesamiento
-    m_HeightData.resize(m_HeightMapWidth * m_HeightMapHeight);
-    m_OriginalHeightData.resize(m_HeightMapWidth * m_HeightMapHeight);
-    m_ErosionChangeMap.resize(m_HeightMapWidth * m_HeightMapHeight, 0.0f);
+    // Lista de bloques visibles de cada frame: como mucho, todos los bloques del mapa
+    BufferDesc BuffDesc;
+    BuffDesc.Name           = "Visible terrain blocks";
+    BuffDesc.Usage          = USAGE_DYNAMIC;
+    BuffDesc.BindFlags      = BIND_VERTEX_BUFFER;
+    BuffDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+    BuffDesc.Size           = sizeof(Uint32) * std::max(1u, (m_HeightMapWidth / m_BlockSize) * (m_HeightMapHeight / m_BlockSize));
+    m_pDevice->CreateBuffer(BuffDesc, nullptr, &m_VisibleBlocksBuffer);
+}
 
-    for (unsigned int i = 0; i < m_HeightMapWidth * m_HeightMapHeight; ++i)
+void Tutorial08_Tessellation::InitializeErosion(std::vector<float> heights, unsigned int width, unsigned int height)
+{
+    // Las alturas decodificadas del archivo deben corresponder a la textura cargada
+    if (width != m_HeightMapWidth || height != m_HeightMapHeight)
     {
-        // Asumiendo que el heightmap es de formato R8G8B8A8, tomamos el canal R como altura
-        m_HeightData[i]         = static_cast<float>(heightMapData[i * 4]) / 255.0f;
-        m_OriginalHeightData[i] = m_HeightData[i];
+        LOG_ERROR_MESSAGE("No se pudieron leer las alturas de ps_height_1k.png; la erosin parte de un terreno plano");
+        heights.assign(m_HeightMapWidth * m_HeightMapHeight, 0.5f); // Mitad de la altura como predeterminado
     }
+
+    m_Erosion.SetHeightmap(std::move(heights), m_HeightMapWidth, m_HeightMapHeight);
+    m_PipeErosion.Reset();
+    m_History.Reset(m_Erosion);
+
+    // Alturas de 8 bits de la textura, de las que salen los lmites de los bloques para el
+    // frustum culling. Hasta la primera subida se ve la textura del archivo, con las mismas alturas.
+    const auto& erosionHeights = m_Erosion.GetHeights();
+    m_DisplayHeights.resize(erosionHeights.size());
+    for (size_t i = 0; i < erosionHeights.size(); ++i)
+        m_DisplayHeights[i] = static_cast<Uint8>(erosionHeights[i] * 255.0f);
+    m_TerrainCulling.Build(m_DisplayHeights.data(), m_HeightMapWidth, m_HeightMapHeight, m_HeightMapWidth / m_BlockSize, m_HeightMapHeight / m_BlockSize);
+
+    // La pendiente del talud se mide con las proporciones con las que se dibuja el terreno:
+    // HeightScale = LengthScale / 25 en Render()
+    m_ThermalErosion.Params.heightScale = m_HeightMapWidth / 25.0f;
 }
 
-float Tutorial08_Tessellation::SampleHeightmap(float x, float y)
+void Tutorial08_Tessellation::ApplyErosionChanges()
 {
-    // Interpolacin bilineal para obtener la altura en una posicin arbitraria
-    int x0 = static_cast<int>(x);
-    int y0 = static_cast<int>(y);
-    int x1 = x0 + 1;
-    int y1 = y0 + 1;
-
-    // Asegurar que las coordenadas estn dentro de los lmites
-    x0 = std::max(0, std::min(x0, static_cast<int>(m_HeightMapWidth) - 1));
-    y0 = std::max(0, std::min(y0, static_cast<int>(m_HeightMapHeight) - 1));
-    x1 = std::max(0, std::min(x1, static_cast<int>(m_HeightMapWidth) - 1));
-    y1 = std::max(0, std::min(y1, static_cast<int>(m_HeightMapHeight) - 1));
-
-    // Calcular factores de interpolacin
-    float tx = x - static_cast<float>(x0);
-    float ty = y - static_cast<float>(y0);
-
-    // Obtener alturas en los cuatro puntos de la cuadrcula
-    float h00 = m_HeightData[y0 * m_HeightMapWidth + x0];
-    float h10 = m_HeightData[y0 * m_HeightMapWidth + x1];
-    float h01 = m_HeightData[y1 * m_HeightMapWidth + x0];
-    float h11 = m_HeightData[y1 * m_HeightMapWidth + x1];
-
-    // Interpolar bilinealmente
-    float h0 = (1.0f - tx) * h00 + tx * h10;
-    float h1 = (1.0f - tx) * h01 + tx * h11;
-    return (1.0f - ty) * h0 + ty * h1;
+    // Aplicar los cambios de erosin al heightmap y limpiar el mapa de cambios
+    m_Erosion.ApplyChanges();
+    m_History.Push(m_Erosion);
+    m_WindowEdited = true;
+
+    // Actualizar la textura de altura
+    UploadHeightMap();
 }
 
-void Tutorial08_Tessellation::ModifyHeightmap(float x, float y, float delta, float radius)
+void Tutorial08_Tessellation::GoToErosionStep(int step)
 {
-    // Modificar el heightmap dentro de un radio usando un kernel gaussiano
-    int r  = static_cast<int>(radius);
-    int x0 = static_cast<int>(x) - r;
-    int y0 = static_cast<int>(y) - r;
-    int x1 = static_cast<int>(x) + r;
-    int y1 = static_cast<int>(y) + r;
-
-    // Asegurar que las coordenadas estn dentro de los lmites
-    x0 = std::max(0, x0);
-    y0 = std::max(0, y0);
-    x1 = std::min(x1, static_cast<int>(m_HeightMapWidth) - 1);
-    y1 = std::min(y1, static_cast<int>(m_HeightMapHeight) - 1);
-
-    float radiusSq = radius * radius;
-
-    // Aplicar modificacin con cada gaussiana
-    for (int cy = y0; cy <= y1; cy++)
+    // Restaurar el heightmap del paso indicado del historial y subir los tiles que cambian
+    if (m_History.GoTo(step, m_Erosion))
     {
-        for (int cx = x0; cx <= x1; cx++)
-        {
-            float dx     = x - static_cast<float>(cx);
-            float dy     = y - static_cast<float>(cy);
-            float distSq = dx * dx + dy * dy;
-
-            if (distSq < radiusSq)
-            {
-                // Calcular peso basado en la distancia (kernel gaussiano)
-                float weight = std::exp(-distSq / (2.0f * radiusSq / 9.0f));
-
-                // Modificar el heightmap
-                int index = cy * m_HeightMapWidth + cx;
-                m_ErosionChangeMap[index] += delta * weight;
-            }
-        }
+        m_WindowEdited = true;
+        UploadHeightMap();
     }
 }
 
-void Tutorial08_Tessellation::SimulateErosion(int dropletCount)
+void Tutorial08_Tessellation::UploadHeightMap()
 {
-    std::random_device                    rd;
-    std::mt19937                          gen(rd());
-    std::uniform_real_distribution<float> posDistX(0, static_cast<float>(m_HeightMapWidth - 1));
-    std::uniform_real_distribution<float> posDistY(0, static_cast<float>(m_HeightMapHeight - 1));
-    std::uniform_real_distribution<float> dirDist(-1.0f, 1.0f);
-
-    // Realizar la simulacin para el nmero de gotas especificado
-    for (int i = 0; i < dropletCount; ++i)
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    // La primera vez se reemplaza la textura cargada del archivo, que es inmutable, por una
+    // que se puede actualizar. Se crea vaca: SetHeightmap marc todo el mapa como modificado.
+    if (m_pHeightMap->GetDesc().Usage != USAGE_DEFAULT)
     {
-        // Crear una nueva gota en una posicin aleatoria
-        Droplet droplet;
-        droplet.position  = float2(posDistX(gen), posDistY(gen));
-        droplet.direction = float2(0, 0);
-        droplet.speed     = 0.0f;
-        droplet.water     = 1.0f;
-        droplet.sediment  = 0.0f;
-
-        // Simular el movimiento de la gota hasta que se evapore o alcance el mximo de pasos
-        for (int lifetime = 0; lifetime < m_ErosionParams.maxPath; ++lifetime)
+        TextureDesc TexDesc;
+        TexDesc.Name      = "Updated Height Map";
+        TexDesc.Type      = RESOURCE_DIM_TEX_2D;
+        TexDesc.Width     = m_HeightMapWidth;
+        TexDesc.Height    = m_HeightMapHeight;
+        TexDesc.Format    = TEX_FORMAT_R8_UNORM;
+        TexDesc.BindFlags = BIND_SHADER_RESOURCE;
+        TexDesc.Usage     = USAGE_DEFAULT;
+
+        RefCntAutoPtr<ITexture> pNewHeightMap;
+        m_pDevice->CreateTexture(TexDesc, nullptr, &pNewHeightMap);
+
+        // Actualizar el SRV y los SRBs para usar la nueva textura
+        m_HeightMapSRV = pNewHeightMap->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+        for (size_t i = 0; i < _countof(m_SRB); ++i)
         {
-            // Obtener coordenadas enteras y fraccionales
-            int   xi = static_cast<int>(droplet.position.x);
-            int   yi = static_cast<int>(droplet.position.y);
-            float xf = droplet.position.x - xi;
-            float yf = droplet.position.y - yi;
-
-            // Salir si la gota est fuera del mapa
-            if (xi < 0 || xi >= static_cast<int>(m_HeightMapWidth - 1) ||
-                yi < 0 || yi >= static_cast<int>(m_HeightMapHeight - 1))
+            if (m_SRB[i])
             {
-                break;
-            }
-
-            // Calcular gradiente usando muestras de altura
-            float h00 = m_HeightData[yi * m_HeightMapWidth + xi];
-            float h10 = m_HeightData[yi * m_HeightMapWidth + xi + 1];
-            float h01 = m_HeightData[(yi + 1) * m_HeightMapWidth + xi];
-            float h11 = m_HeightData[(yi + 1) * m_HeightMapWidth + xi + 1];
-
-            // Calcular gradiente utilizando interpolacin bilineal
-            float2 gradient;
-            gradient.x = ((h10 - h00) * (1.0f - yf) + (h11 - h01) * yf);
-            gradient.y = ((h01 - h00) * (1.0f - xf) + (h11 - h10) * xf);
-
-            // Actualizar direccin basada en el gradiente y la inercia
-            if (length(gradient) <= FLT_EPSILON)
-            {
-                // Si el gradiente es casi cero, elegir una direccin aleatoria
-                droplet.direction = normalize(float2(dirDist(gen), dirDist(gen)));
-            }
-            else
-            {
-                // Combinar la direccin actual con el gradiente negativo (cuesta abajo)
-                gradient          = -normalize(gradient);
-                droplet.direction = normalize(
-                    droplet.direction * m_ErosionParams.inertia +
-                    gradient * (1.0f - m_ErosionParams.inertia));
+                m_SRB[i]->GetVariableByName(SHADER_TYPE_DOMAIN, "g_HeightMap")->Set(m_HeightMapSRV);
+                m_SRB[i]->GetVariableByName(SHADER_TYPE_HULL, "g_HeightMap")->Set(m_HeightMapSRV);
             }
+        }
 
-            // Calcular la nueva posicin
-            float2 newPos = droplet.position + droplet.direction;
+        // Reemplazar la textura anterior con la nueva
+        m_pHeightMap = pNewHeightMap;
+    }
 
-            // Obtener alturas
-            float oldHeight  = SampleHeightmap(droplet.position.x, droplet.position.y);
-            float newHeight  = SampleHeightmap(newPos.x, newPos.y);
-            float heightDiff = newHeight - oldHeight;
+    // Convertir y subir solo las regiones modificadas
+    const auto& heights = m_Erosion.GetHeights();
+    const auto  regions = m_Erosion.TakeDirtyRegions();
 
-            // Determinar si deposita o erosiona
-            if (heightDiff > 0)
-            {
-                // Si va cuesta arriba, deposita sedimento para rellenar
-                float depositAmount = std::min(heightDiff, droplet.sediment);
-                ModifyHeightmap(droplet.position.x, droplet.position.y, depositAmount, 1.0f);
-                droplet.sediment -= depositAmount;
-                droplet.speed = 0.0f;
-            }
-            else
+    m_UploadRegions = static_cast<int>(regions.size());
+    m_UploadTexels  = 0;
+    for (const auto& region : regions)
+    {
+        for (unsigned int y = 0; y < region.Height; ++y)
+        {
+            for (unsigned int x = 0; x < region.Width; ++x)
             {
-                // Calcular capacidad de transporte
-                float slope    = std::max(-heightDiff, m_ErosionParams.minSlope);
-                float capacity = slope * droplet.speed * droplet.water * m_ErosionParams.capacity;
+                unsigned int mapX   = region.X + x;
+                unsigned int mapY   = region.Y + y;
+                float        height = heights[mapY * m_HeightMapWidth + mapX];
 
-                // Decidir entre depositar o erosionar
-                if (droplet.sediment > capacity)
-                {
-                    // Depositar exceso de sedimento
-                    float depositAmount = (droplet.sediment - capacity) * m_ErosionParams.deposition;
-                    ModifyHeightmap(droplet.position.x, droplet.position.y, depositAmount, 1.0f);
-                    droplet.sediment -= depositAmount;
-                }
-                else
+                // Si la altura es muy baja, usar un gradiente de prueba para asegurar visibilidad
+                if (height < 0.05f)
                 {
-                    // Erosionar el terreno
-                    float erosionAmount = std::min(
-                        (capacity - droplet.sediment) * m_ErosionParams.erosion,
-                        -heightDiff // No erosionar ms que la diferencia de altura
-                    );
-
-                    // Distribuir la erosin en un radio
-                    ModifyHeightmap(droplet.position.x, droplet.position.y, -erosionAmount, m_ErosionParams.radius);
-                    droplet.sediment += erosionAmount;
+                    float normalizedX = static_cast<float>(mapX) / m_HeightMapWidth;
+                    float normalizedY = static_cast<float>(mapY) / m_HeightMapHeight;
+                    height            = 0.1f + (normalizedX + normalizedY) * 0.4f;
                 }
-            }
 
-            // Actualizar velocidad y posicin
-            droplet.speed    = sqrt(droplet.speed * droplet.speed + std::fabs(heightDiff) * m_ErosionParams.gravity);
-            droplet.position = newPos;
+                // Convertir a byte
+                m_DisplayHeights[mapY * m_HeightMapWidth + mapX] = static_cast<Uint8>(height * 255.0f);
+            }
+        }
 
-            // Reducir el agua por evaporacin
-            droplet.water *= (1.0f - m_ErosionParams.evaporation);
+        TextureSubResData SubresData;
+        SubresData.pData  = &m_DisplayHeights[static_cast<size_t>(region.Y) * m_HeightMapWidth + region.X];
+        SubresData.Stride = m_HeightMapWidth;
 
-            // Si se ha evaporado toda el agua, terminar la simulacin
-            if (droplet.water < 0.01f)
-                break;
-        }
+        Box UpdateBox{region.X, region.X + region.Width, region.Y, region.Y + region.Height};
+        m_pImmediateContext->UpdateTexture(m_pHeightMap, 0, 0, UpdateBox, SubresData,
+                                           RESOURCE_STATE_TRANSITION_MODE_TRANSITION, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_UploadTexels += region.Width * region.Height;
     }
+
+    // Los lmites de los bloques para el frustum culling siguen a las alturas subidas
+    m_TerrainCulling.Update(m_DisplayHeights.data(), regions);
+
+    m_UploadSeconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
 }
 
-void Tutorial08_Tessellation::ApplyErosionChanges()
+void Tutorial08_Tessellation::OpenTiledTerrain(bool create)
 {
-    // Aplicar los cambios de erosin al heightmap
-    for (unsigned int i = 0; i < m_HeightMapWidth * m_HeightMapHeight; ++i)
+    // El archivo se crea con el mapa actual o se abre uno existente, por ejemplo uno grande
+    // convertido con ErosionCLI; la ventana empieza en el centro del terreno
+    const char* path = "terrain.tiles";
+    bool        opened;
+    if (create)
     {
-        m_HeightData[i] += m_ErosionChangeMap[i];
-        // Asegurar que la altura est en el rango [0, 1]
-        m_HeightData[i] = std::max(0.0f, std::min(1.0f, m_HeightData[i]));
+        opened = m_TiledTerrain.Create(path, m_HeightMapWidth, m_HeightMapHeight);
+        if (opened)
+        {
+            m_TiledTerrain.WriteRegion(0, 0, m_HeightMapWidth, m_HeightMapHeight, m_Erosion.GetHeights().data(), m_HeightMapWidth);
+            m_TiledTerrain.UpdateMips();
+        }
     }
+    else
+        opened = m_TiledTerrain.Open(path, true) || m_TiledTerrain.Open(path, false);
 
-    // Limpiar el mapa de cambios
-    std::fill(m_ErosionChangeMap.begin(), m_ErosionChangeMap.end(), 0.0f);
-
-    // Actualizar la textura de altura
-    CreateUpdatedHeightMap();
+    if (!opened)
+    {
+        LOG_ERROR_MESSAGE("No se pudo abrir terrain.tiles");
+        return;
+    }
+    m_PageCache.SetTerrain(&m_TiledTerrain);
+    m_PageCache.MemoryLimit = static_cast<size_t>(m_PageCacheLimitMB) << 20;
+    m_TerrainFocus          = float2(0.5f, 0.5f);
+    m_WindowEdited          = false;
 }
 
-void Tutorial08_Tessellation::SaveErosionState()
+void Tutorial08_Tessellation::CloseTiledTerrain()
 {
-    // Guardar una copia del estado actual para poder revertir
-    std::copy(m_HeightData.begin(), m_HeightData.end(), m_OriginalHeightData.begin());
+    m_PageCache.SetTerrain(nullptr);
+    m_TiledTerrain.Close();
+
+    // Volver al mapa del archivo de imagen
+    std::vector<float> heights;
+    unsigned int       width = 0, height = 0;
+    if (!LoadHeightmapImageCached("ps_height_1k.png", heights, width, height))
+        heights.clear();
+    InitializeErosion(std::move(heights), width, height);
+    UploadHeightMap();
 }
 
-void Tutorial08_Tessellation::RevertErosion()
+void Tutorial08_Tessellation::UpdateTiledTerrain()
 {
-    // Restaurar los datos originales del heightmap
-    std::copy(m_OriginalHeightData.begin(), m_OriginalHeightData.end(), m_HeightData.begin());
-    std::fill(m_ErosionChangeMap.begin(), m_ErosionChangeMap.end(), 0.0f);
-
-    // Actualizar la textura de altura
-    CreateUpdatedHeightMap();
+    // Mover la ventana la vuelve a cargar del archivo, as que con erosin sin guardar se queda
+    // donde est (con el mismo nivel) hasta que se guarda o se descarta
+    if (m_WindowEdited)
+        return;
 
-    // Resetear contador de iteraciones
-    m_ErosionIterationCount = 0;
-}
-
-void Tutorial08_Tessellation::CreateUpdatedHeightMap()
-{
-    // Crear una nueva textura con los datos de altura modificados
-    TextureDesc TexDesc;
-    TexDesc.Name      = "Updated Height Map";
-    TexDesc.Type      = RESOURCE_DIM_TEX_2D;
-    TexDesc.Width     = m_HeightMapWidth;
-    TexDesc.Height    = m_HeightMapHeight;
-    TexDesc.Format    = TEX_FORMAT_R8_UNORM;
-    TexDesc.BindFlags = BIND_SHADER_RESOURCE;
-    TexDesc.Usage     = USAGE_DEFAULT;
-
-    // Crear vector para almacenar datos de altura
-    std::vector<uint8_t> heightMapBytes(m_HeightMapWidth * m_HeightMapHeight);
-
-    // Crear un patrn de prueba con gradiente para asegurar visibilidad
-    for (unsigned int y = 0; y < m_HeightMapHeight; ++y)
+    const int levels = static_cast<int>(m_TiledTerrain.GetLevelCount());
+    if (m_AutoTerrainLevel)
     {
-        for (unsigned int x = 0; x < m_HeightMapWidth; ++x)
-        {
-            float normalizedX = static_cast<float>(x) / m_HeightMapWidth;
-            float normalizedY = static_cast<float>(y) / m_HeightMapHeight;
-
-            // Usar los datos existentes pero asegurar que no sean totalmente negros
-            unsigned int idx    = y * m_HeightMapWidth + x;
-            float        height = (idx < m_HeightData.size()) ? m_HeightData[idx] : 0.0f;
-
-            // Si la altura es muy baja, usar un gradiente de prueba
-            if (height < 0.05f)
-            {
-                height = 0.1f + (normalizedX + normalizedY) * 0.4f;
-            }
-
-            // Convertir a byte
-            heightMapBytes[y * m_HeightMapWidth + x] = static_cast<uint8_t>(height * 255.0f);
-        }
+        // A la distancia mxima la ventana cubre todo el terreno; cada vez que la distancia se
+        // reduce a la mitad se baja un nivel
+        int fitLevel = 0;
+        while (fitLevel + 1 < levels &&
+               (m_TiledTerrain.GetWidth(fitLevel) > m_HeightMapWidth || m_TiledTerrain.GetHeight(fitLevel) > m_HeightMapHeight))
+            ++fitLevel;
+        m_TerrainLevel = fitLevel + static_cast<int>(std::floor(std::log2(m_Distance / 20.f) + 0.5f));
     }
-
-    TextureSubResData SubresData;
-    SubresData.pData  = heightMapBytes.data();
-    SubresData.Stride = m_HeightMapWidth;
-
-    TextureData TexData;
-    TexData.NumSubresources = 1;
-    TexData.pSubResources   = &SubresData;
-
-    RefCntAutoPtr<ITexture> pNewHeightMap;
-    m_pDevice->CreateTexture(TexDesc, &TexData, &pNewHeightMap);
-
-    // Actualizar el SRV para usar la nueva textura
-    m_HeightMapSRV = pNewHeightMap->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
-
-    // Actualizar los SRBs para usar la nueva textura
-    for (size_t i = 0; i < _countof(m_SRB); ++i)
+    m_TerrainLevel = std::max(0, std::min(m_TerrainLevel, levels - 1));
+
+    // Ventana centrada en el foco y dentro del nivel, movida en pasos de un tile del motor: cada
+    // movimiento vuelve a copiar la ventana completa, pero los cambios pequeos del foco no la mueven
+    const unsigned int level       = static_cast<unsigned int>(m_TerrainLevel);
+    const int          levelWidth  = static_cast<int>(m_TiledTerrain.GetWidth(level));
+    const int          levelHeight = static_cast<int>(m_TiledTerrain.GetHeight(level));
+    const int          step        = static_cast<int>(ErosionEngine::TileSize);
+
+    int x = static_cast<int>(m_TerrainFocus.x * levelWidth - m_HeightMapWidth * 0.5f) / step * step;
+    int y = static_cast<int>(m_TerrainFocus.y * levelHeight - m_HeightMapHeight * 0.5f) / step * step;
+    x     = std::max(0, std::min(x, levelWidth - static_cast<int>(m_HeightMapWidth)));
+    y     = std::max(0, std::min(y, levelHeight - static_cast<int>(m_HeightMapHeight)));
+
+    m_TerrainWindowX = static_cast<unsigned int>(x);
+    m_TerrainWindowY = static_cast<unsigned int>(y);
+    if (m_PageCache.UpdateWindow(m_Erosion, level, m_TerrainWindowX, m_TerrainWindowY) > 0)
     {
-        if (m_SRB[i])
-        {
-            m_SRB[i]->GetVariableByName(SHADER_TYPE_DOMAIN, "g_HeightMap")->Set(m_HeightMapSRV);
-            m_SRB[i]->GetVariableByName(SHADER_TYPE_HULL, "g_HeightMap")->Set(m_HeightMapSRV);
-        }
+        // Llegaron tiles nuevos: el historial y el agua de las tuberas parten de la ventana actual
+        m_PipeErosion.Reset();
+        m_History.Reset(m_Erosion);
+        UploadHeightMap();
     }
+}
 
-    // Reemplazar la textura anterior con la nueva
-    m_pHeightMap = pNewHeightMap;
+void Tutorial08_Tessellation::SaveTiledWindow()
+{
+    // Solo la ventana del nivel 0 tiene la resolucin del archivo; los mips se recalculan y se
+    // descartan de la cach los tiles que cambian
+    HeightmapRegion region;
+    region.X      = m_TerrainWindowX;
+    region.Y      = m_TerrainWindowY;
+    region.Width  = std::min(m_HeightMapWidth, m_TiledTerrain.GetWidth() - region.X);
+    region.Height = std::min(m_HeightMapHeight, m_TiledTerrain.GetHeight() - region.Y);
+
+    m_TiledTerrain.WriteRegion(region.X, region.Y, region.Width, region.Height, m_Erosion.GetHeights().data(), m_HeightMapWidth);
+    m_TiledTerrain.UpdateMips();
+    m_PageCache.Invalidate(region);
+    m_WindowEdited = false;
 }
 
 void Tutorial08_Tessellation::UpdateUI()
 {
+    // Mientras llegan los tiles de la ventana, parte del mapa todava es de la ventana anterior:
+    // hasta que est completa no se acepta erosin, ni pasos del historial, ni guardarla
+    const bool windowLoading = m_TiledTerrain.IsOpen() && m_PageCache.GetPendingTiles() > 0;
+
     ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
     if (ImGui::Begin("Settings", nullptr, ImGuiWindowFlags_AlwaysAutoResize))
     {
@@ -643,53 +570,204 @@ void Tutorial08_Tessellation::UpdateUI()
         ImGui::SliderFloat("Tess density", &m_TessDensity, 1.f, 32.f);
         ImGui::SliderFloat("Distance", &m_Distance, 1.f, 20.f);
 
+        ImGui::Checkbox("Frustum culling", &m_FrustumCulling);
+        if (m_FrustumCulling)
+        {
+            const auto& CullStats = m_TerrainCulling.GetStats();
+            ImGui::Text("Bloques: %u de %u (%.0f%%), %u nodos probados, %.3f ms", CullStats.VisibleBlocks, CullStats.TotalBlocks,
+                        CullStats.TotalBlocks > 0 ? 100.0f * CullStats.VisibleBlocks / CullStats.TotalBlocks : 0.0f,
+                        CullStats.TestedNodes, CullStats.Seconds * 1000.0f);
+        }
+
         // Informacin de depuracin
         ImGui::Text("HeightMap Size: %dx%d", m_HeightMapWidth, m_HeightMapHeight);
-        ImGui::Text("HeightData Size: %zu", m_HeightData.size());
+        const auto& heights = m_Erosion.GetHeights();
+        ImGui::Text("HeightData Size: %zu", heights.size());
 
         // Mostrar muestras de alturas
-        if (!m_HeightData.empty())
+        if (!heights.empty())
         {
-            ImGui::Text("Sample Heights [0]: %.3f", m_HeightData[0]);
-            size_t middle = m_HeightData.size() / 2;
-            if (middle < m_HeightData.size())
-                ImGui::Text("Sample Heights [mid]: %.3f", m_HeightData[middle]);
+            ImGui::Text("Sample Heights [0]: %.3f", heights[0]);
+            size_t middle = heights.size() / 2;
+            if (middle < heights.size())
+                ImGui::Text("Sample Heights [mid]: %.3f", heights[middle]);
         }
 
         // Nueva seccin de UI para erosin
         if (ImGui::CollapsingHeader("Erosin Hidrulica", ImGuiTreeNodeFlags_DefaultOpen))
         {
-            if (ImGui::Button("Aplicar erosin"))
+            ImGui::Combo("Modelo", &m_ErosionSolver, "Gotas\0Tuberas virtuales\0");
+
+            if (windowLoading)
+                ImGui::Text("Cargando la ventana: %d tiles pendientes", m_PageCache.GetPendingTiles());
+            else
             {
-                // Guardar estado antes de aplicar nuevos cambios
-                if (m_ErosionIterationCount == 0)
-                    SaveErosionState();
+                if (ImGui::Button("Aplicar erosin"))
+                {
+                    // Simular erosin; los dos modelos dejan la diferencia en el mapa de cambios del motor
+                    if (m_ErosionSolver == 0)
+                        m_Erosion.Simulate(m_Erosion.Params.dropletCount, std::random_device{}());
+                    else
+                        m_PipeErosion.Run(m_Erosion);
+
+                    // La erosin trmica parte del terreno ya erosionado; las dos quedan en el mismo paso del historial
+                    if (m_ThermalAfterErosion)
+                    {
+                        m_Erosion.ApplyChanges();
+                        m_ThermalErosion.Run(m_Erosion);
+                    }
+                    ApplyErosionChanges();
+                }
 
-                // Simular erosin
-                SimulateErosion(m_ErosionParams.dropletCount);
-                ApplyErosionChanges();
-                m_ErosionIterationCount++;
+                ImGui::SameLine();
+                if (ImGui::Button("Deshacer"))
+                    GoToErosionStep(m_History.GetStep() - 1);
+
+                ImGui::SameLine();
+                if (ImGui::Button("Rehacer"))
+                    GoToErosionStep(m_History.GetStep() + 1);
+
+                ImGui::SameLine();
+                if (ImGui::Button("Revertir"))
+                    GoToErosionStep(m_History.GetOldestStep());
+            }
+
+            ImGui::Text("Iteraciones: %d", m_History.GetStep());
+
+            // Historial: cualquier paso guardado se puede recuperar directamente
+            if (!windowLoading && m_History.GetNewestStep() > m_History.GetOldestStep())
+            {
+                int step = m_History.GetStep();
+                if (ImGui::SliderInt("Paso", &step, m_History.GetOldestStep(), m_History.GetNewestStep()))
+                    GoToErosionStep(step);
             }
+            ImGui::Text("Historial: pasos %d a %d, %.1f MB", m_History.GetOldestStep(), m_History.GetNewestStep(),
+                        m_History.GetMemoryUsage() / (1024.0f * 1024.0f));
+            if (ImGui::SliderInt("Lmite historial (MB)", &m_HistoryLimitMB, 16, 1024))
+                m_History.MemoryLimit = static_cast<size_t>(m_HistoryLimitMB) << 20;
+
+            ImGui::SliderInt("Hilos", &m_Erosion.NumThreads, 1, static_cast<int>(std::max(1u, std::thread::hardware_concurrency())));
+            // Tiempo de la ltima iteracin de cada modelo, para compararlos
+            if (m_Erosion.GetLastSeconds() > 0)
+                ImGui::Text("Gotas: %.1f ms/iteracin (%.0f gotas/s)", m_Erosion.GetLastSeconds() * 1000.0f, m_Erosion.GetDropletsPerSecond());
+            if (m_PipeErosion.GetLastSeconds() > 0)
+                ImGui::Text("Tuberas: %.1f ms/iteracin (%.2f ms/paso)", m_PipeErosion.GetLastSeconds() * 1000.0f,
+                            m_PipeErosion.GetLastSeconds() * 1000.0f / m_PipeErosion.Params.stepsPerIteration);
+
+            if (m_UploadTexels > 0)
+                ImGui::Text("Subida: %d regiones, %.0f%% del mapa, %.2f ms", m_UploadRegions,
+                            100.0f * m_UploadTexels / (m_HeightMapWidth * m_HeightMapHeight), m_UploadSeconds * 1000.0f);
+
+            if (m_ErosionSolver == 0)
+            {
+                if (ImGui::Button("Medir gotas/s"))
+                    m_ErosionBenchmark = m_Erosion.Benchmark(m_Erosion.Params.dropletCount, std::random_device{}());
+                if (m_ErosionBenchmark.SerialRate > 0)
+                {
+                    ImGui::Text("1 hilo: %.0f gotas/s, cambio medio %.2e", m_ErosionBenchmark.SerialRate, m_ErosionBenchmark.SerialMeanChange);
+                    ImGui::Text("%d hilos: %.0f gotas/s (x%.1f), cambio medio %.2e", m_Erosion.NumThreads, m_ErosionBenchmark.ParallelRate,
+                                m_ErosionBenchmark.ParallelRate / m_ErosionBenchmark.SerialRate, m_ErosionBenchmark.ParallelMeanChange);
+                }
 
-            ImGui::SameLine();
+                ImGui::SliderFloat("Inertia", &m_Erosion.Params.inertia, 0.0f, 1.0f);
+                ImGui::SliderFloat("Capacidad sedimento", &m_Erosion.Params.capacity, 1.0f, 16.0f);
+                ImGui::SliderFloat("Velocidad deposicin", &m_Erosion.Params.deposition, 0.0f, 1.0f);
+                ImGui::SliderFloat("Velocidad erosin", &m_Erosion.Params.erosion, 0.0f, 1.0f);
+                ImGui::SliderFloat("Evaporacin", &m_Erosion.Params.evaporation, 0.0f, 0.1f);
+                ImGui::SliderFloat("Pendiente mnima", &m_Erosion.Params.minSlope, 0.0001f, 0.05f);
+                ImGui::SliderFloat("Gravedad", &m_Erosion.Params.gravity, 1.0f, 20.0f);
+                ImGui::SliderFloat("Radio erosin", &m_Erosion.Params.radius, 1.0f, 8.0f);
+                ImGui::SliderInt("Longitud mx. camino", &m_Erosion.Params.maxPath, 16, 256);
+                ImGui::SliderInt("Gotas por iteracin", &m_Erosion.Params.dropletCount, 1000, 50000);
+            }
+            else
+            {
+                if (ImGui::Button("Vaciar agua"))
+                    m_PipeErosion.Reset();
+                ImGui::SameLine();
+                ImGui::Text("Agua: %.0f", m_PipeErosion.GetTotalWater());
+
+                ImGui::SliderFloat("Lluvia", &m_PipeErosion.Params.rain, 0.0f, 0.5f);
+                ImGui::SliderFloat("Evaporacin", &m_PipeErosion.Params.evaporation, 0.0f, 0.5f);
+                ImGui::SliderFloat("Capacidad sedimento", &m_PipeErosion.Params.capacity, 0.0f, 0.5f);
+                ImGui::SliderFloat("Velocidad disolucin", &m_PipeErosion.Params.dissolving, 0.0f, 0.5f);
+                ImGui::SliderFloat("Velocidad deposicin", &m_PipeErosion.Params.deposition, 0.0f, 0.5f);
+                ImGui::SliderFloat("Profundidad erosin", &m_PipeErosion.Params.erosionDepth, 0.01f, 4.0f);
+                ImGui::SliderFloat("Paso de tiempo", &m_PipeErosion.Params.timeStep, 0.005f, 0.1f);
+                ImGui::SliderInt("Pasos por iteracin", &m_PipeErosion.Params.stepsPerIteration, 1, 200);
+            }
+        }
 
-            if (ImGui::Button("Revertir"))
+        if (ImGui::CollapsingHeader("Erosin Trmica", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            if (!windowLoading && ImGui::Button("Aplicar erosin trmica"))
             {
-                RevertErosion();
+                m_ThermalErosion.Run(m_Erosion);
+                ApplyErosionChanges();
             }
+            ImGui::Checkbox("Tras cada erosin hidrulica", &m_ThermalAfterErosion);
+            if (m_ThermalErosion.GetLastSeconds() > 0)
+                ImGui::Text("Trmica: %.1f ms (%.2f ms/iteracin)", m_ThermalErosion.GetLastSeconds() * 1000.0f,
+                            m_ThermalErosion.GetLastSeconds() * 1000.0f / m_ThermalErosion.Params.iterations);
+
+            ImGui::SliderFloat("ngulo del talud", &m_ThermalErosion.Params.talusAngle, 5.0f, 60.0f);
+            ImGui::SliderFloat("Intensidad", &m_ThermalErosion.Params.strength, 0.0f, 1.0f);
+            ImGui::SliderInt("Iteraciones", &m_ThermalErosion.Params.iterations, 1, 200);
+        }
 
-            ImGui::Text("Iteraciones: %d", m_ErosionIterationCount);
-
-            ImGui::SliderFloat("Inertia", &m_ErosionParams.inertia, 0.0f, 1.0f);
-            ImGui::SliderFloat("Capacidad sedimento", &m_ErosionParams.capacity, 1.0f, 16.0f);
-            ImGui::SliderFloat("Velocidad deposicin", &m_ErosionParams.deposition, 0.0f, 1.0f);
-            ImGui::SliderFloat("Velocidad erosin", &m_ErosionParams.erosion, 0.0f, 1.0f);
-            ImGui::SliderFloat("Evaporacin", &m_ErosionParams.evaporation, 0.0f, 0.1f);
-            ImGui::SliderFloat("Pendiente mnima", &m_ErosionParams.minSlope, 0.0001f, 0.05f);
-            ImGui::SliderFloat("Gravedad", &m_ErosionParams.gravity, 1.0f, 20.0f);
-            ImGui::SliderFloat("Radio erosin", &m_ErosionParams.radius, 1.0f, 8.0f);
-            ImGui::SliderInt("Longitud mx. camino", &m_ErosionParams.maxPath, 16, 256);
-            ImGui::SliderInt("Gotas por iteracin", &m_ErosionParams.dropletCount, 1000, 50000);
+        if (ImGui::CollapsingHeader("Terreno por Tiles"))
+        {
+            if (!m_TiledTerrain.IsOpen())
+            {
+                if (ImGui::Button("Abrir terrain.tiles"))
+                    OpenTiledTerrain(false);
+                ImGui::SameLine();
+                if (ImGui::Button("Crear del mapa actual"))
+                    OpenTiledTerrain(true);
+                ImGui::Text("Mapas grandes: ErosionCLI mapa.raw terrain.tiles --size AxB");
+            }
+            else
+            {
+                ImGui::Text("terrain.tiles: %ux%u, %u niveles, %.0f MB", m_TiledTerrain.GetWidth(), m_TiledTerrain.GetHeight(),
+                            m_TiledTerrain.GetLevelCount(), m_TiledTerrain.GetFileSize() / (1024.0f * 1024.0f));
+                ImGui::SliderFloat("Centro X", &m_TerrainFocus.x, 0.0f, 1.0f);
+                ImGui::SliderFloat("Centro Y", &m_TerrainFocus.y, 0.0f, 1.0f);
+                ImGui::Checkbox("Nivel segn la distancia", &m_AutoTerrainLevel);
+                if (!m_AutoTerrainLevel)
+                    ImGui::SliderInt("Nivel", &m_TerrainLevel, 0, static_cast<int>(m_TiledTerrain.GetLevelCount()) - 1);
+                ImGui::Text("Ventana: (%u, %u) del nivel %d (%ux%u)", m_TerrainWindowX, m_TerrainWindowY, m_TerrainLevel,
+                            m_TiledTerrain.GetWidth(m_TerrainLevel), m_TiledTerrain.GetHeight(m_TerrainLevel));
+                if (m_WindowEdited)
+                    ImGui::Text("Ventana fija: tiene erosin sin guardar");
+
+                ImGui::Text("Cach: %zu tiles, %.0f MB, %d pendientes", m_PageCache.GetResidentTiles(),
+                            m_PageCache.GetMemoryUsage() / (1024.0f * 1024.0f), m_PageCache.GetPendingTiles());
+                ImGui::Text("Lecturas: %d en %.2f ms, %llu en total", m_PageCache.GetLastLoads(), m_PageCache.GetLastLoadSeconds() * 1000.0f,
+                            static_cast<unsigned long long>(m_PageCache.GetTotalLoads()));
+                if (ImGui::SliderInt("Lmite cach (MB)", &m_PageCacheLimitMB, 16, 2048))
+                    m_PageCache.MemoryLimit = static_cast<size_t>(m_PageCacheLimitMB) << 20;
+                ImGui::SliderInt("Lecturas por frame", &m_PageCache.LoadsPerUpdate, 1, 64);
+
+                // La erosin acta sobre la ventana; solo la del nivel 0 se puede guardar en el archivo
+                if (m_TerrainLevel == 0 && m_TiledTerrain.IsWritable() && !windowLoading)
+                {
+                    if (ImGui::Button("Guardar ventana en el archivo"))
+                        SaveTiledWindow();
+                    ImGui::SameLine();
+                }
+                if (m_WindowEdited)
+                {
+                    // La ventana se vuelve a copiar de la cach o del archivo en el siguiente Update()
+                    if (ImGui::Button("Descartar erosin"))
+                    {
+                        m_WindowEdited = false;
+                        m_PageCache.ReloadWindow();
+                    }
+                    ImGui::SameLine();
+                }
+                if (ImGui::Button("Cerrar"))
+                    CloseTiledTerrain();
+            }
         }
 
         // UI para el color y parmetros del terreno
@@ -718,6 +796,7 @@ void Tutorial08_Tessellation::Initialize(const SampleInitInfo& InitInfo)
 
     CreatePipelineStates();
     LoadTextures();
+    CreateVisibleBlocksBuffer();
 }
 
 // Render a frame
@@ -737,6 +816,24 @@ void Tutorial08_Tessellation::Render()
 
     unsigned int NumHorzBlocks = m_HeightMapWidth / m_BlockSize;
     unsigned int NumVertBlocks = m_HeightMapHeight / m_BlockSize;
+    const float  LengthScale   = 10.f;
+    const float  HeightScale   = LengthScale / 25.f;
+
+    // Bloques que se dibujan: los que pueden verse segn la pirmide de alturas, o todos
+    if (m_FrustumCulling)
+        m_TerrainCulling.Cull(m_WorldViewProjMatrix, m_pDevice->GetDeviceInfo().IsGLDevice(), LengthScale, HeightScale, m_VisibleBlocks);
+    else
+    {
+        m_VisibleBlocks.resize(NumHorzBlocks * NumVertBlocks);
+        for (Uint32 i = 0; i < m_VisibleBlocks.size(); ++i)
+            m_VisibleBlocks[i] = i;
+    }
+    if (!m_VisibleBlocks.empty())
+    {
+        MapHelper<Uint32> BlockIDs(m_pImmediateContext, m_VisibleBlocksBuffer, MAP_WRITE, MAP_FLAG_DISCARD);
+        std::copy(m_VisibleBlocks.begin(), m_VisibleBlocks.end(), static_cast<Uint32*>(BlockIDs));
+    }
+
     {
         // Map the buffer and write rendering data
         MapHelper<GlobalConstants> Consts(m_pImmediateContext, m_ShaderConstants, MAP_WRITE, MAP_FLAG_DISCARD);
@@ -746,8 +843,8 @@ void Tutorial08_Tessellation::Render()
         Consts->fNumHorzBlocks = static_cast<float>(NumHorzBlocks);
         Consts->fNumVertBlocks = static_cast<float>(NumVertBlocks);
 
-        Consts->LengthScale = 10.f;
-        Consts->HeightScale = Consts->LengthScale / 25.f;
+        Consts->LengthScale = LengthScale;
+        Consts->HeightScale = HeightScale;
 
         Consts->WorldView     = m_WorldViewMatrix;
         Consts->WorldViewProj = m_WorldViewProjMatrix;
@@ -792,10 +889,17 @@ void Tutorial08_Tessellation::Render()
     // makes sure that resources are transitioned to required states.
     m_pImmediateContext->CommitShaderResources(m_SRB[m_Wireframe ? 1 : 0], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
+    const Uint64 offset   = 0;
+    IBuffer*     pBuffs[] = {m_VisibleBlocksBuffer};
+    m_pImmediateContext->SetVertexBuffers(0, 1, pBuffs, &offset, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
+
+    // Una instancia por bloque visible, cada una un parche de un punto de control
     DrawAttribs DrawAttrs;
-    DrawAttrs.NumVertices = NumHorzBlocks * NumVertBlocks;
-    DrawAttrs.Flags       = DRAW_FLAG_VERIFY_ALL;
-    m_pImmediateContext->Draw(DrawAttrs);
+    DrawAttrs.NumVertices  = 1;
+    DrawAttrs.NumInstances = static_cast<Uint32>(m_VisibleBlocks.size());
+    DrawAttrs.Flags        = DRAW_FLAG_VERIFY_ALL;
+    if (DrawAttrs.NumInstances > 0)
+        m_pImmediateContext->Draw(DrawAttrs);
 }
 
 void Tutorial08_Tessellation::Update(double CurrTime, double ElapsedTime)
@@ -803,6 +907,10 @@ void Tutorial08_Tessellation::Update(double CurrTime, double ElapsedTime)
     SampleBase::Update(CurrTime, ElapsedTime);
     UpdateUI();
 
+    // Cargar los tiles que faltan de la ventana del terreno por tiles
+    if (m_TiledTerrain.IsOpen())
+        UpdateTiledTerrain();
+
     // Set world view matrix
     if (m_Animate)
     {
@@ -2,36 +2,18 @@
 
 #include "SampleBase.hpp"
 #include "BasicMath.hpp"
+#include "ErosionEngine.hpp"
+#include "ErosionHistory.hpp"
+#include "PipeErosion.hpp"
+#include "ThermalErosion.hpp"
+#include "TiledTerrain.hpp"
+#include "TerrainPageCache.hpp"
+#include "TerrainCulling.hpp"
 #include <vector>
 
 namespace Diligent
 {
 
-// Estructura para el manejo de una gota de agua en la simulacin de erosin
-struct Droplet
-{
-    float2 position;  // Posicin x,z en el mapa
-    float2 direction; // Direccin normalizada de movimiento
-    float  speed;     // Velocidad actual
-    float  water;     // Cantidad de agua
-    float  sediment;  // Cantidad de sedimento transportado
-};
-
-// Parmetros para la simulacin de erosin
-struct ErosionParams
-{
-    float inertia      = 0.3f;  // Persistencia de la direccin (0-1)
-    float capacity     = 8.0f;  // Capacidad de sedimento
-    float deposition   = 0.2f;  // Velocidad de deposicin (0-1)
-    float erosion      = 0.7f;  // Velocidad de erosin (0-1)
-    float evaporation  = 0.02f; // Tasa de evaporacin (0-1)
-    float minSlope     = 0.01f; // Pendiente mnima para la erosin
-    float gravity      = 10.0f; // Fuerza de gravedad
-    float radius       = 4.0f;  // Radio de erosin
-    int   maxPath      = 64;    // Pasos mximos por gota
-    int   dropletCount = 10000; // Nmero de gotas por ronda
-};
-
 class Tutorial08_Tessellation final : public SampleBase
 {
 public:
@@ -46,17 +28,20 @@ public:
 private:
     void CreatePipelineStates();
     void LoadTextures();
+    void CreateVisibleBlocksBuffer();
     void UpdateUI();
 
     // Nuevos mtodos para la erosin
-    void  InitializeErosion();
-    void  SimulateErosion(int dropletCount);
-    void  CreateUpdatedHeightMap();
-    float SampleHeightmap(float x, float y);
-    void  ModifyHeightmap(float x, float y, float delta, float radius);
-    void  ApplyErosionChanges();
-    void  RevertErosion();
-    void  SaveErosionState();
+    void InitializeErosion(std::vector<float> heights, unsigned int width, unsigned int height);
+    void UploadHeightMap();
+    void ApplyErosionChanges();
+    void GoToErosionStep(int step);
+
+    // Terreno por tiles
+    void OpenTiledTerrain(bool create);
+    void CloseTiledTerrain();
+    void UpdateTiledTerrain();
+    void SaveTiledWindow();
 
     RefCntAutoPtr<IPipelineState>         m_pPSO[2];
     RefCntAutoPtr<IShaderResourceBinding> m_SRB[2];
@@ -65,6 +50,7 @@ private:
     RefCntAutoPtr<ITextureView>           m_ColorMapSRV;
     RefCntAutoPtr<ITexture>               m_pHeightMap;
     RefCntAutoPtr<ITexture>               m_pColorMap;
+    RefCntAutoPtr<IBuffer>                m_VisibleBlocksBuffer;
 
     float4x4 m_WorldViewProjMatrix;
     float4x4 m_WorldViewMatrix;
@@ -81,11 +67,37 @@ private:
     unsigned int m_HeightMapHeight = 0;
 
     // Nuevas variables para erosin
-    std::vector<float> m_OriginalHeightData;        // Copia del mapa de altura original
-    std::vector<float> m_HeightData;                // Datos de altura actuales
-    std::vector<float> m_ErosionChangeMap;          // Mapa de cambios por erosin
-    ErosionParams      m_ErosionParams;             // Parmetros de erosin
-    int                m_ErosionIterationCount = 0; // Contador de iteraciones
+    ErosionEngine    m_Erosion;                     // Mapa de alturas actual y simulacin de gotas
+    PipeErosion      m_PipeErosion;                 // Simulacin en rejilla (tuberas virtuales)
+    int              m_ErosionSolver       = 0;     // 0: gotas, 1: tuberas virtuales
+    ThermalErosion   m_ThermalErosion;              // Relajacin de las pendientes que superan el talud
+    bool             m_ThermalAfterErosion = false; // Erosin trmica tras cada iteracin hidrulica
+    ErosionHistory   m_History;                     // Deshacer/rehacer de cada iteracin
+    int              m_HistoryLimitMB      = 256;   // Memoria mxima del historial
+    ErosionBenchmark m_ErosionBenchmark;            // ltima medicin de gotas/s
+
+    // Subida a la GPU de los tiles modificados
+    std::vector<Uint8> m_DisplayHeights;    // Alturas de 8 bits de la textura, de todo el mapa
+    int                m_UploadRegions = 0; // Regiones de la ltima subida
+    unsigned int       m_UploadTexels  = 0; // Texels de la ltima subida
+    float              m_UploadSeconds = 0; // Duracin de la ltima subida
+
+    // Terreno por tiles: el mapa de alturas es una ventana del archivo, del nivel de detalle
+    // que corresponde a la distancia de la cmara
+    TiledTerrain     m_TiledTerrain;
+    TerrainPageCache m_PageCache;
+    float2           m_TerrainFocus     = float2(0.5f, 0.5f); // Centro de la ventana, relativo al terreno
+    bool             m_AutoTerrainLevel = true;               // Nivel elegido segn m_Distance
+    int              m_TerrainLevel     = 0;                  // Nivel de la ventana
+    unsigned int     m_TerrainWindowX   = 0;                  // Esquina de la ventana, en celdas de su nivel
+    unsigned int     m_TerrainWindowY   = 0;                  //
+    int              m_PageCacheLimitMB = 256;                // Memoria mxima de la cach de tiles
+    bool             m_WindowEdited     = false;              // Erosin sin guardar: la ventana no se mueve
+
+    // Frustum culling de los bloques del terreno
+    TerrainCulling      m_TerrainCulling;        // Alturas mnima y mxima de los bloques
+    std::vector<Uint32> m_VisibleBlocks;         // Bloques que se dibujan en el frame actual
+    bool                m_FrustumCulling = true; // Si es false se dibujan todos los bloques
 
     // Variables para apariencia del terreno
     float4 m_GrassColor          = float4(0.3f, 0.9f, 0.3f, 1.0f);